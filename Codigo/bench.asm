@@ -0,0 +1,39 @@
+; bench.asm
+; programa para medir a velocidade do executor de instruções da CPU
+;   (ver bench_cpu.c)
+; só usa CPU, em laços curtos como os de p1.asm
+; termina com uma chamada de sistema, com o total contado em A
+
+N        define 200    ; quantas vezes repete o laço interno
+M        define 10000  ; até quanto conta no laço interno
+CADA     define 7      ; conta os múltiplos disto
+
+         cargi 0
+         armm total
+         cargi N
+         armm i
+externo  cargi 0
+         trax
+interno  incx
+         cpxa
+         resto cada
+         desvnz pula
+         cargm total
+         soma um
+         armm total
+pula     cpxa
+         sub eme
+         desvnz interno
+         cargm i
+         sub um
+         armm i
+         desvnz externo
+         cargm total
+         chamas
+         para
+
+i        espaco 1
+total    espaco 1
+um       valor 1
+cada     valor CADA
+eme      valor M
@@ -0,0 +1,103 @@
+// bench_cpu.c
+// mede a velocidade do executor de instruções da CPU
+// simulador de computador
+// so25b
+
+// executa o programa bench.maq em modo usuário, sem SO e sem dispositivos,
+//   e informa o número de instruções executadas por segundo
+// executado por "make bench" (ver Makefile)
+
+#include "cpu.h"
+#include "mmu.h"
+#include "tabpag.h"
+#include "memoria.h"
+#include "programa.h"
+#include "es.h"
+#include "instrucao.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+
+#define MEM_TAM 1000
+
+// as instruções executadas em cada chamada a cpu_executa_n
+#define INSTR_POR_LOTE 1000
+
+// chamada pela instrução CHAMAC do tratador de interrupção, quando o
+//   programa termina
+static int termina(void *arg, int reg_A)
+{
+  bool *pterminou = arg;
+  *pterminou = true;
+  return reg_A;
+}
+
+// coloca o programa 'nome' na memória
+static void carrega_programa(mem_t *mem, char *nome)
+{
+  programa_t *prog = prog_cria(nome);
+  if (prog == NULL) {
+    fprintf(stderr, "Erro na leitura de '%s'\n", nome);
+    exit(1);
+  }
+  int end_ini = prog_end_carga(prog);
+  int end_fim = end_ini + prog_tamanho(prog);
+  for (int end = end_ini; end < end_fim; end++) {
+    if (mem_escreve(mem, end, prog_dado(prog, end)) != ERR_OK) {
+      fprintf(stderr, "Erro na carga da memória, endereco %d\n", end);
+      exit(1);
+    }
+  }
+  // a CPU começa em modo supervisor; um RETI no endereço de reset faz ela
+  //   começar a executar o programa em modo usuário
+  mem_escreve(mem, CPU_END_RESET, RETI);
+  mem_escreve(mem, CPU_END_PC, prog_end_inicio(prog));
+  mem_escreve(mem, CPU_END_A, 0);
+  mem_escreve(mem, CPU_END_erro, ERR_OK);
+  mem_escreve(mem, CPU_END_complemento, 0);
+  // o tratador de interrupção avisa que o programa terminou
+  mem_escreve(mem, CPU_END_TRATADOR, CHAMAC);
+  mem_escreve(mem, CPU_END_TRATADOR + 1, PARA);
+  prog_destroi(prog);
+}
+
+int main(int argc, char *argv[argc])
+{
+  char *nome = argc > 1 ? argv[1] : "bench.maq";
+
+  mem_t *mem = mem_cria(MEM_TAM);
+  carrega_programa(mem, nome);
+  // mapeia todas as páginas nos quadros de mesmo número, para que os acessos
+  //   passem pela tradução de endereços
+  tabpag_t *tabpag = tabpag_cria(0);
+  for (int pag = 0; pag < MEM_TAM / TAM_PAGINA; pag++) {
+    tabpag_define_quadro(tabpag, pag, pag);
+  }
+  mmu_t *mmu = mmu_cria(mem);
+  mmu_define_tabpag(mmu, tabpag);
+  es_t *es = es_cria();
+  cpu_t *cpu = cpu_cria(mmu, es);
+  bool terminou = false;
+  cpu_define_chamaC(cpu, termina, &terminou);
+
+  long instrucoes = 0;
+  clock_t inicio = clock();
+  while (!terminou) {
+    instrucoes += cpu_executa_n(cpu, INSTR_POR_LOTE);
+  }
+  double tempo = (double)(clock() - inicio) / CLOCKS_PER_SEC;
+
+  int total;
+  mem_le(mem, CPU_END_A, &total);
+  printf("%s: resultado %d, %ld instruções em %.3f s (%.1f milhões/s)\n",
+         nome, total, instrucoes, tempo, instrucoes / tempo / 1e6);
+
+  cpu_destroi(cpu);
+  es_destroi(es);
+  mmu_destroi(mmu);
+  tabpag_destroi(tabpag);
+  mem_destroi(mem);
+  return 0;
+}
@@ -58,6 +58,14 @@ struct console_t {
   char txt_entrada[N_COL+1];
   char fila_de_comandos_externos[N_CMD_EXT];
   FILE *arquivo_de_log;
+  // false para execução em lote, sem tela
+  bool com_tela;
+  // de onde ler os comandos do operador quando sem tela (pode ser NULL)
+  FILE *arquivo_de_comandos;
+  // para onde copiar a saída de cada terminal quando sem tela
+  FILE *arquivo_do_terminal[N_TERM];
+  // o sistema informou um erro interno
+  bool sistema_falhou;
 };
 
 
@@ -65,15 +73,43 @@ struct console_t {
 // CRIAÇÃO {{{1
 // ---------------------------------------------------------------------
 
+// abre um arquivo de saída com nome 'prefixo' seguido de 'nome'
+// termina a simulação se não conseguir (por exemplo, diretório do prefixo
+//   inexistente), como main.c faz com o arquivo de comandos
+static FILE *abre_arquivo(char *prefixo, char *nome)
+{
+  char nome_completo[strlen(prefixo) + strlen(nome) + 1];
+  strcpy(nome_completo, prefixo);
+  strcat(nome_completo, nome);
+  FILE *arquivo = fopen(nome_completo, "w");
+  if (arquivo == NULL) {
+    fprintf(stderr, "ERRO: não consegui criar '%s'\n", nome_completo);
+    exit(1);
+  }
+  return arquivo;
+}
+
+static void insere_comando_externo(console_t *self, char c);
+
 static console_t *console_global; // gambiarra para simplificar o uso de prints na console
-console_t *console_cria(void)
+console_t *console_cria(bool com_tela, FILE *comandos, char *prefixo)
 {
   console_t *self = malloc(sizeof(*self));
   assert(self != NULL);
   console_global = self;
+  self->com_tela = com_tela;
+  self->arquivo_de_comandos = comandos;
+  self->sistema_falhou = false;
 
   for (int t = 0; t < N_TERM; t++) {
     self->term[t] = terminal_cria(N_COL);
+    self->arquivo_do_terminal[t] = NULL;
+    if (!com_tela) {
+      char nome[] = "saida_do_terminal_A";
+      nome[strlen(nome) - 1] += t;
+      self->arquivo_do_terminal[t] = abre_arquivo(prefixo, nome);
+      terminal_define_copia_da_saida(self->term[t], self->arquivo_do_terminal[t]);
+    }
     if ((t % 2) == 0) {
       self->cor_txt[t] = COR_TXT_PAR;
       self->cor_cursor[t] = COR_CURSOR_PAR;
@@ -87,9 +123,14 @@ console_t *console_cria(void)
   }
   strcpy(self->txt_entrada, "");
   self->fila_de_comandos_externos[0] = '\0';
-  self->arquivo_de_log = fopen("log_da_console", "w");
+  self->arquivo_de_log = abre_arquivo(prefixo, "log_da_console");
 
-  tela_init();
+  if (com_tela) {
+    tela_init();
+  } else {
+    // sem operador para mandar continuar
+    insere_comando_externo(self, 'C');
+  }
 
   return self;
 }
@@ -98,17 +139,20 @@ static void console_desenha(console_t *self);
 
 void console_destroi(console_t *self)
 {
-  console_desenha(self);
   if (self->arquivo_de_log != NULL) fclose(self->arquivo_de_log);
-  tela_puts(COR_OCUPADO, "  digite ENTER para sair  ");
-  tela_atualiza();
-  while (tela_tecla() != '\n') {
-    ;
+  if (self->com_tela) {
+    console_desenha(self);
+    tela_puts(COR_OCUPADO, "  digite ENTER para sair  ");
+    tela_atualiza();
+    while (tela_tecla() != '\n') {
+      ;
+    }
+    tela_fim();
   }
-  tela_fim();
 
   for (int t = 0; t < N_TERM; t++) {
     terminal_destroi(self->term[t]);
+    if (self->arquivo_do_terminal[t] != NULL) fclose(self->arquivo_do_terminal[t]);
   }
   free(self);
   return;
@@ -261,7 +305,7 @@ static void interpreta_linha_entrada(console_t *self)
       break;
     case 'D':
       val = atoi(&linha[1]);
-      tela_espera(val);
+      if (self->com_tela) tela_espera(val);
       break;
     case 'P':
     case '1':
@@ -294,12 +338,55 @@ static void verifica_entrada(console_t *self)
   } // senão, ignora o caractere digitado
 }
 
+// sem tela, lê e interpreta uma linha do arquivo de comandos, se houver
+static void le_linha_de_comandos(console_t *self)
+{
+  if (self->arquivo_de_comandos == NULL) return;
+  if (fgets(self->txt_entrada, sizeof(self->txt_entrada), self->arquivo_de_comandos) == NULL) {
+    // acabaram os comandos
+    self->arquivo_de_comandos = NULL;
+    strcpy(self->txt_entrada, "");
+    return;
+  }
+  self->txt_entrada[strcspn(self->txt_entrada, "\r\n")] = '\0';
+  interpreta_linha_entrada(self);
+}
+
 char console_comando_externo(console_t *self)
 {
-  verifica_entrada(self);
+  if (self->com_tela) verifica_entrada(self);
   return remove_comando_externo(self);
 }
 
+bool console_tem_tela(console_t *self)
+{
+  return self->com_tela;
+}
+
+void console_sistema_terminou(console_t *self)
+{
+  if (!self->com_tela) {
+    console_printf("Sistema sem processos, fim da execução em lote.");
+    insere_comando_externo(self, 'F');
+  }
+}
+
+void console_erro_no_sistema(console_t *self)
+{
+  // só na primeira vez
+  if (self->sistema_falhou) return;
+  self->sistema_falhou = true;
+  if (!self->com_tela) {
+    console_printf("Erro interno no sistema, fim da execução em lote.");
+    insere_comando_externo(self, 'F');
+  }
+}
+
+bool console_sistema_falhou(console_t *self)
+{
+  return self->sistema_falhou;
+}
+
 
 // ---------------------------------------------------------------------
 // DESENHO {{{1
@@ -371,9 +458,14 @@ static void console_desenha(console_t *self)
 
 void console_tictac(console_t *self)
 {
-  verifica_entrada(self);
-  atualiza_terminais(self);
-  console_desenha(self);
+  if (self->com_tela) {
+    verifica_entrada(self);
+    atualiza_terminais(self);
+    console_desenha(self);
+  } else {
+    le_linha_de_comandos(self);
+    atualiza_terminais(self);
+  }
 }
 
 // vim: foldmethod=marker
@@ -7,12 +7,22 @@
 #define CONSOLE_H
 
 #include <stdbool.h>
+#include <stdio.h>
 #include "terminal.h"
 
 typedef struct console_t console_t;
 
 // cria e inicializa a console
-console_t *console_cria(void);
+// se 'com_tela' for false, a console funciona sem tela, para execução em lote:
+//   - as linhas de comando do operador (as mesmas aceitas na tela, como
+//     "ea30" para entrar "30" no terminal A) são lidas de 'comandos', uma
+//     por vez a cada chamada a console_tictac ('comandos' pode ser NULL)
+//   - a saída de cada terminal é copiada para um arquivo
+//   - a execução começa sem esperar o comando 'C', e termina quando o
+//     sistema informar que não tem mais o que fazer (console_sistema_terminou)
+// os arquivos gerados (log da console e saída dos terminais) têm o nome
+//   iniciado por 'prefixo' (que pode conter um diretório)
+console_t *console_cria(bool com_tela, FILE *comandos, char *prefixo);
 
 // destrói a console
 void console_destroi(console_t *self);
@@ -40,4 +50,22 @@ terminal_t *console_terminal(console_t *self, char id_terminal);
 // esta função deve ser chamada periodicamente para que tela funcione
 void console_tictac(console_t *self);
 
+// retorna true se a console está usando a tela
+// sem tela, não tem por que formatar a linha de status
+bool console_tem_tela(console_t *self);
+
+// informa à console que o sistema não tem mais nada para executar
+// sem tela, isso encerra a simulação (como o comando 'F'); com tela, o
+//   operador decide
+void console_sistema_terminou(console_t *self);
+
+// informa à console que o sistema encontrou um erro interno e não consegue
+//   continuar
+// sem tela, isso encerra a simulação, que termina com erro (ver
+//   console_sistema_falhou); com tela, o operador decide
+void console_erro_no_sistema(console_t *self);
+
+// retorna true se o sistema informou um erro interno (console_erro_no_sistema)
+bool console_sistema_falhou(console_t *self);
+
 #endif // CONSOLE_H
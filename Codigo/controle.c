@@ -10,19 +10,30 @@
 #include <stdio.h>
 #include <assert.h>
 
+// número máximo de instruções executadas em um lote, entre dois atendimentos
+//   à console
+#define MAX_INSTR_POR_LOTE 1000
+
 struct controle_t {
   cpu_t *cpu;
   relogio_t *relogio;
+  disco_t *disco;
   console_t *console;
   enum { executando, passo, parado, fim } estado;
+  // número máximo de instruções a executar entre dois atendimentos à console
+  //   (1 para executar uma instrução por vez)
+  int max_lote;
 };
 
 // funções auxiliares
+static int controle_executa(controle_t *self);
+static void controle_verifica_interrupcao(controle_t *self);
 static void controle_processa_comandos_da_console(controle_t *self);
 static void controle_atualiza_estado_na_console(controle_t *self);
 
 
-controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio)
+controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio,
+                          disco_t *disco)
 {
   controle_t *self = malloc(sizeof(*self));
   assert(self != NULL);
@@ -30,7 +41,9 @@ controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio)
   self->cpu = cpu;
   self->console = console;
   self->relogio = relogio;
+  self->disco = disco;
   self->estado = parado;
+  self->max_lote = MAX_INSTR_POR_LOTE;
 
   return self;
 }
@@ -40,23 +53,23 @@ void controle_destroi(controle_t *self)
   free(self);
 }
 
+void controle_define_lote(controle_t *self, int max_lote)
+{
+  self->max_lote = max_lote < 1 ? 1 : max_lote;
+}
+
 void controle_laco(controle_t *self)
 {
-  // executa uma instrução por vez até a console dizer que chega
+  // executa um lote de instruções por vez até a console dizer que chega
   do {
-    if (self->estado == passo || self->estado == executando) {
+    if (self->estado == passo) {
       cpu_executa_1(self->cpu);
       relogio_tictac(self->relogio);
-
-      if (self->estado == passo) self->estado = parado;
-
-      // enquanto não tem controlador de interrupção, fala direto com o relógio
-      // o dispositivo 3 do relógio contém 1 se o timer expirou
-      int tem_int;
-      relogio_leitura(self->relogio, 3, &tem_int);
-      if (tem_int != 0) {
-        cpu_interrompe(self->cpu, IRQ_RELOGIO);
-      }
+      disco_avanca(self->disco, 1);
+      self->estado = parado;
+      controle_verifica_interrupcao(self);
+    } else if (self->estado == executando) {
+      controle_executa(self);
     }
     console_tictac(self->console);
 
@@ -66,6 +79,44 @@ void controle_laco(controle_t *self)
 
   console_printf("Fim da execução.");
 }
+
+// executa um lote de instruções, que termina quando o timer do relógio
+//   expira, quando o disco conclui uma transferência ou antes, se a CPU
+//   decidir (ver cpu_executa_n)
+// retorna o número de instruções executadas
+static int controle_executa(controle_t *self)
+{
+  // o dispositivo 2 do relógio contém o tempo até a próxima interrupção
+  //   (0 se não tem interrupção programada)
+  int n = self->max_lote;
+  int t_ate_int;
+  relogio_leitura(self->relogio, 2, &t_ate_int);
+  if (t_ate_int > 0 && t_ate_int < n) n = t_ate_int;
+  int t_ate_disco = disco_tempo_ate_conclusao(self->disco);
+  if (t_ate_disco > 0 && t_ate_disco < n) n = t_ate_disco;
+
+  int executadas = cpu_executa_n(self->cpu, n);
+  relogio_avanca(self->relogio, executadas);
+  disco_avanca(self->disco, executadas);
+  controle_verifica_interrupcao(self);
+  return executadas;
+}
+
+static void controle_verifica_interrupcao(controle_t *self)
+{
+  // enquanto não tem controlador de interrupção, fala direto com o relógio
+  // o dispositivo 3 do relógio contém 1 se o timer expirou
+  int tem_int;
+  relogio_leitura(self->relogio, 3, &tem_int);
+  if (tem_int != 0) {
+    cpu_interrompe(self->cpu, IRQ_RELOGIO);
+  }
+  // o dispositivo 3 do disco contém 1 se tem transferência concluída
+  disco_leitura(self->disco, 3, &tem_int);
+  if (tem_int != 0) {
+    cpu_interrompe(self->cpu, IRQ_DISCO);
+  }
+}
  
 
 static void controle_processa_comandos_da_console(controle_t *self)
@@ -89,6 +140,8 @@ static void controle_processa_comandos_da_console(controle_t *self)
 
 static void controle_atualiza_estado_na_console(controle_t *self)
 {
+  // sem tela, ninguém vai ver
+  if (!console_tem_tela(self->console)) return;
   char status[100];
   switch (self->estado) {
     case fim:        strcpy(status, "FIM    | "); break;
@@ -11,10 +11,21 @@ typedef struct controle_t controle_t;
 #include "cpu.h"
 #include "console.h"
 #include "relogio.h"
+#include "disco.h"
 
-controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio);
+controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio,
+                          disco_t *disco);
 void controle_destroi(controle_t *self);
 
+// define o número máximo de instruções executadas entre dois atendimentos à
+//   console quando em execução contínua (o padrão é MAX_INSTR_POR_LOTE, em
+//   controle.c)
+// o lote termina antes quando o timer do relógio expira, quando uma
+//   transferência do disco termina, ou em erro, interrupção ou acesso a
+//   dispositivo
+// com 1, a execução é feita uma instrução por vez
+void controle_define_lote(controle_t *self, int max_lote);
+
 // o laço principal da simulação
 void controle_laco(controle_t *self);
 
@@ -22,6 +22,28 @@
 // DECLARAÇÃO {{{1
 // ---------------------------------------------------------------------
 
+// instrução pré-decodificada
+// a CPU mantém uma dessas para cada endereço da memória física, para não ter
+//   que decodificar (e traduzir o endereço do argumento) a cada execução de
+//   uma instrução. A entrada é invalidada quando a memória é alterada no
+//   endereço da instrução, do seu argumento ou de outra instrução do seu
+//   bloco.
+typedef struct {
+  // a entrada contém uma instrução decodificada
+  bool valida;
+  // o argumento está no mesmo quadro da instrução, e foi decodificado
+  bool tem_A1;
+  int opcode;
+  int A1;
+  // número de palavras ocupadas pela instrução
+  int tam;
+  // função que implementa a instrução
+  void (*executa)(cpu_t *self);
+  // número de instruções do bloco básico que inicia nesta instrução; as
+  //   demais são as seguintes na memória física (ver BUSCA E DECODIFICAÇÃO)
+  int n_bloco;
+} instr_decod_t;
+
 // uma CPU tem estado, memória, controlador de ES
 struct cpu_t {
   // registradores
@@ -34,7 +56,12 @@ struct cpu_t {
   cpu_modo_t modo;
   // acesso a dispositivos externos
   mmu_t *mmu;
+  mem_t *mem;
   es_t *es;
+  // instruções pré-decodificadas, uma por endereço físico
+  instr_decod_t *decod;
+  // instrução em execução, se foi obtida de 'decod'
+  instr_decod_t *instr;
   // identificação das instruções privilegiadas
   bool privilegiadas[N_OPCODE];
   // função e argumento para implementar instrução CHAMAC
@@ -47,6 +74,8 @@ struct cpu_t {
 // CRIAÇÃO {{{1
 // ---------------------------------------------------------------------
 
+static void invalida_decod(void *arg, int endereco);
+
 cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
 {
   cpu_t *self;
@@ -54,8 +83,16 @@ cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
   assert(self != NULL);
 
   self->mmu = mmu;
+  self->mem = mmu_mem(mmu);
   self->es = es;
 
+  // inicializa a cache de instruções decodificadas (todas inválidas), e pede
+  //   para a memória avisar das alterações, para manter a cache coerente
+  self->decod = calloc(mem_tam(self->mem), sizeof(*self->decod));
+  assert(self->decod != NULL);
+  self->instr = NULL;
+  mem_define_observador(self->mem, invalida_decod, self);
+
   // inicializa registradores
   //   a CPU começa executando no endereço CPU_END_RESET em modo supervisor
   self->PC = CPU_END_RESET;
@@ -80,6 +117,8 @@ cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
 void cpu_destroi(cpu_t *self)
 {
   // quem criou mmu e e/s que destrua!
+  mem_define_observador(self->mem, NULL, NULL);
+  free(self->decod);
   free(self);
 }
 
@@ -188,22 +227,14 @@ static bool poe_es(cpu_t *self, int dispositivo, int val)
   return false;
 }
 
-// lê o opcode da instrução no PC
-// retorna true se ele pode ser executado, ou põe em erro o motivo de não poder
-static bool pega_opcode(cpu_t *self, int *popc)
-{
-  // não pode executar se houver erro na leitura da memória
-  if (!pega_mem(self, self->PC, popc)) return false;
-  // pode executar se tiver privilégio para isso
-  if (self->modo == supervisor || !self->privilegiadas[*popc]) return true;
-  // não pode executar instrução privilegiada em modo usuário
-  self->erro = ERR_INSTR_PRIV;
-  return false;
-}
-
 // lê o argumento 1 da instrução no PC
+// usa o valor pré-decodificado, se houver
 static bool pega_A1(cpu_t *self, int *pA1)
 {
+  if (self->instr != NULL && self->instr->tem_A1) {
+    *pA1 = self->instr->A1;
+    return true;
+  }
   return pega_mem(self, self->PC + 1, pA1);
 }
 
@@ -447,55 +478,210 @@ static void op_CHAMAS(cpu_t *self) // chamada de sistema
 }
 
 
+// função que implementa cada instrução, indexada pelo opcode
+// os opcodes sem função (pseudo-instruções) são inválidos
+static void (*const funcoes_das_instrucoes[N_OPCODE])(cpu_t *self) = {
+  [NOP]    = op_NOP,
+  [PARA]   = op_PARA,
+  [CARGI]  = op_CARGI,
+  [CARGM]  = op_CARGM,
+  [CARGX]  = op_CARGX,
+  [ARMM]   = op_ARMM,
+  [ARMX]   = op_ARMX,
+  [TRAX]   = op_TRAX,
+  [CPXA]   = op_CPXA,
+  [INCX]   = op_INCX,
+  [SOMA]   = op_SOMA,
+  [SUB]    = op_SUB,
+  [MULT]   = op_MULT,
+  [DIV]    = op_DIV,
+  [RESTO]  = op_RESTO,
+  [NEG]    = op_NEG,
+  [DESV]   = op_DESV,
+  [DESVZ]  = op_DESVZ,
+  [DESVNZ] = op_DESVNZ,
+  [DESVN]  = op_DESVN,
+  [DESVP]  = op_DESVP,
+  [CHAMA]  = op_CHAMA,
+  [RET]    = op_RET,
+  [LE]     = op_LE,
+  [ESCR]   = op_ESCR,
+  [RETI]   = op_RETI,
+  [CHAMAC] = op_CHAMAC,
+  [CHAMAS] = op_CHAMAS,
+};
+
 // ---------------------------------------------------------------------
-// EXECUÇÃO DE UMA INSTRUÇÃO {{{1
+// BUSCA E DECODIFICAÇÃO {{{1
 // ---------------------------------------------------------------------
 
-static void executa_a_instrucao(cpu_t *self, int opcode)
+// blocos básicos
+// as instruções decodificadas são agrupadas em blocos básicos: sequências de
+//   instruções consecutivas na memória física, dentro de um mesmo quadro, que
+//   são sempre executadas em sequência, porque só a última pode desviar
+// cada instrução decodificada tem o número de instruções do bloco que inicia
+//   nela (ver forma_bloco); no executor em lote, só a primeira instrução do
+//   bloco é buscada (com tradução de endereço e verificação de privilégio), as
+//   demais são executadas em seguida
+// um bloco termina em uma instrução que desvia (DESV*, CHAMA, RET, CHAMAS) ou
+//   no fim do quadro; instruções privilegiadas ou que acessam dispositivos
+//   (PARA, LE, ESCR, RETI, CHAMAC) formam um bloco sozinhas
+// os blocos são encadeados: quando o bloco seguinte (o destino do desvio ou a
+//   instrução depois do fim do bloco) está na mesma página, ele é obtido
+//   diretamente no mesmo quadro, sem traduzir o endereço (ver busca_bloco)
+// uma escrita na memória invalida as instruções decodificadas desde o início
+//   do quadro até o endereço escrito, que são as que podem iniciar um bloco que
+//   inclui esse endereço (como as variáveis "espaco 1" usadas por CHAMA para
+//   guardar o endereço de retorno, que ficam no meio do código)
+
+// retorna true se a instrução só pode estar sozinha em um bloco
+static bool instrucao_isolada(int opcode)
 {
   switch (opcode) {
-    case NOP:    op_NOP(self);    break;
-    case PARA:   op_PARA(self);   break;
-    case CARGI:  op_CARGI(self);  break;
-    case CARGM:  op_CARGM(self);  break;
-    case CARGX:  op_CARGX(self);  break;
-    case ARMM:   op_ARMM(self);   break;
-    case ARMX:   op_ARMX(self);   break;
-    case TRAX:   op_TRAX(self);   break;
-    case CPXA:   op_CPXA(self);   break;
-    case INCX:   op_INCX(self);   break;
-    case SOMA:   op_SOMA(self);   break;
-    case SUB:    op_SUB(self);    break;
-    case MULT:   op_MULT(self);   break;
-    case DIV:    op_DIV(self);    break;
-    case RESTO:  op_RESTO(self);  break;
-    case NEG:    op_NEG(self);    break;
-    case DESV:   op_DESV(self);   break;
-    case DESVZ:  op_DESVZ(self);  break;
-    case DESVNZ: op_DESVNZ(self); break;
-    case DESVN:  op_DESVN(self);  break;
-    case DESVP:  op_DESVP(self);  break;
-    case CHAMA:  op_CHAMA(self);  break;
-    case RET:    op_RET(self);    break;
-    case LE:     op_LE(self);     break;
-    case ESCR:   op_ESCR(self);   break;
-    case RETI:   op_RETI(self);   break;
-    case CHAMAC: op_CHAMAC(self); break;
-    case CHAMAS: op_CHAMAS(self); break;
-    default:     self->erro = ERR_INSTR_INV;
+    case PARA: case LE: case ESCR: case RETI: case CHAMAC:
+      return true;
+    default:
+      return false;
   }
 }
 
-void cpu_executa_1(cpu_t *self)
+// retorna true se a instrução termina um bloco
+static bool instrucao_final(int opcode)
 {
-  // não executa se CPU já estiver em erro
-  if (self->erro != ERR_OK) return;
+  switch (opcode) {
+    case DESV: case DESVZ: case DESVNZ: case DESVN: case DESVP:
+    case CHAMA: case RET: case CHAMAS:
+      return true;
+    default:
+      return instrucao_isolada(opcode);
+  }
+}
+
+// chamada pela memória a cada escrita
+// invalida as instruções pré-decodificadas que usam o endereço alterado: as que
+//   estão no mesmo quadro, desde o início dele até o endereço alterado (a que
+//   está nesse endereço, a anterior, que pode ter nele o seu argumento, e as
+//   que iniciam blocos que podem incluir esse endereço)
+static void invalida_decod(void *arg, int endereco)
+{
+  cpu_t *self = arg;
+  for (int end = endereco - endereco % TAM_PAGINA; end <= endereco; end++) {
+    self->decod[end].valida = false;
+  }
+}
+
+static bool decodifica(cpu_t *self, int endfis, instr_decod_t *instr);
+
+// calcula o número de instruções do bloco que inicia na instrução decodificada
+//   em 'endfis'
+// decodifica as demais instruções do bloco
+static void forma_bloco(cpu_t *self, int endfis, instr_decod_t *instr)
+{
+  int fim_do_quadro = endfis - endfis % TAM_PAGINA + TAM_PAGINA;
+  // o último quadro pode estar incompleto, se o tamanho da memória não for
+  //   múltiplo do tamanho da página
+  if (fim_do_quadro > mem_tam(self->mem)) fim_do_quadro = mem_tam(self->mem);
+  int end = endfis;
+  instr_decod_t *ultima = instr;
+  instr->n_bloco = 1;
+  while (!instrucao_final(ultima->opcode)) {
+    end += ultima->tam;
+    if (end >= fim_do_quadro) break;
+    instr_decod_t *prox = &self->decod[end];
+    if (!prox->valida && !decodifica(self, end, prox)) break;
+    if (instrucao_isolada(prox->opcode)) break;
+    instr->n_bloco++;
+    ultima = prox;
+  }
+}
 
+// decodifica a instrução no endereço físico 'endfis' para 'instr'
+// retorna false se o opcode for inválido ou não puder ser lido
+static bool decodifica(cpu_t *self, int endfis, instr_decod_t *instr)
+{
   int opcode;
-  if (pega_opcode(self, &opcode)) {
-    executa_a_instrucao(self, opcode);
+  if (mem_le(self->mem, endfis, &opcode) != ERR_OK) return false;
+  if (opcode < 0 || opcode >= N_OPCODE || funcoes_das_instrucoes[opcode] == NULL) {
+    return false;
+  }
+  instr->opcode = opcode;
+  instr->executa = funcoes_das_instrucoes[opcode];
+  instr->tam = 1 + instrucao_num_args(opcode);
+  // o argumento só pode ser pré-decodificado se estiver no mesmo quadro,
+  //   senão o endereço físico dele depende do mapeamento da página seguinte
+  instr->tem_A1 = (endfis % TAM_PAGINA) != TAM_PAGINA - 1
+                  && mem_le(self->mem, endfis + 1, &instr->A1) == ERR_OK;
+  instr->valida = true;
+  forma_bloco(self, endfis, instr);
+  return true;
+}
+
+// obtém a instrução decodificada no endereço físico 'endfis', que é o
+//   endereço do PC
+// retorna NULL e põe em erro o motivo caso ela não possa ser executada
+static instr_decod_t *instrucao_em(cpu_t *self, int endfis)
+{
+  instr_decod_t *instr = &self->decod[endfis];
+  if (!instr->valida && !decodifica(self, endfis, instr)) {
+    self->erro = ERR_INSTR_INV;
+    return NULL;
   }
+  // não pode executar instrução privilegiada em modo usuário
+  if (self->modo == usuario && self->privilegiadas[instr->opcode]) {
+    self->erro = ERR_INSTR_PRIV;
+    return NULL;
+  }
+  return instr;
+}
 
+// obtém a instrução no PC, decodificada
+// retorna NULL e põe em erro o motivo caso ela não possa ser executada
+static instr_decod_t *busca_instrucao(cpu_t *self)
+{
+  // o endereço físico é necessário mesmo que a instrução já esteja
+  //   decodificada: a tradução verifica o acesso e marca a página como acessada
+  int endfis;
+  self->erro = mmu_traduz(self->mmu, self->PC, &endfis, self->modo);
+  if (self->erro != ERR_OK) {
+    self->complemento = self->PC;
+    return NULL;
+  }
+  return instrucao_em(self, endfis);
+}
+
+// obtém o bloco que inicia no PC (a instrução decodificada no PC)
+// '*ppagina' e '*pquadro' são a página e o endereço físico do início do quadro
+//   do bloco anterior (ou -1), e são alterados para os do bloco obtido
+// se o PC está na mesma página do bloco anterior, não traduz o endereço: a
+//   página já foi traduzida e marcada como acessada, e continua mapeada no
+//   mesmo quadro, porque a tabela de páginas não muda durante um lote
+// retorna NULL e põe em erro o motivo caso o bloco não possa ser executado
+static instr_decod_t *busca_bloco(cpu_t *self, int *ppagina, int *pquadro)
+{
+  if (self->PC >= 0 && self->PC / TAM_PAGINA == *ppagina) {
+    return instrucao_em(self, *pquadro + self->PC % TAM_PAGINA);
+  }
+  int endfis;
+  self->erro = mmu_traduz(self->mmu, self->PC, &endfis, self->modo);
+  if (self->erro != ERR_OK) {
+    self->complemento = self->PC;
+    *ppagina = -1;
+    return NULL;
+  }
+  *ppagina = self->PC / TAM_PAGINA;
+  *pquadro = endfis - self->PC % TAM_PAGINA;
+  return instrucao_em(self, endfis);
+}
+
+
+// ---------------------------------------------------------------------
+// EXECUÇÃO DE UMA INSTRUÇÃO {{{1
+// ---------------------------------------------------------------------
+
+// causa uma interrupção se a execução (ou a busca) da instrução deixou a
+//   CPU em erro
+static void trata_erro_da_instrucao(cpu_t *self)
+{
   // se a CPU entrou em erro, causa uma interrupção
   // a menos que a CPU tenha parado, porque a única forma de a CPU entrar nesse
   //   estado é pela execução da instrução PARA em modo supervisor, e é a forma de
@@ -507,6 +693,89 @@ void cpu_executa_1(cpu_t *self)
   }
 }
 
+// executa a instrução 'instr', obtida por busca_instrucao
+// se a busca falhou ('instr' é NULL), só trata o erro
+static void executa_a_instrucao(cpu_t *self, instr_decod_t *instr)
+{
+  if (instr != NULL) {
+    self->instr = instr;
+    instr->executa(self);
+    self->instr = NULL;
+  }
+  trata_erro_da_instrucao(self);
+}
+
+void cpu_executa_1(cpu_t *self)
+{
+  // não executa se CPU já estiver em erro
+  if (self->erro != ERR_OK) return;
+
+  executa_a_instrucao(self, busca_instrucao(self));
+}
+
+// instruções que acessam dispositivos: quando executadas em lote, têm que ser
+//   a primeira instrução do lote e encerram o lote, para que vejam os
+//   dispositivos (em especial o relógio) atualizados
+// essas instruções estão sempre sozinhas em um bloco
+static bool acessa_dispositivo(int opcode)
+{
+  return opcode == LE || opcode == ESCR || opcode == CHAMAC;
+}
+
+// executa até 'max' instruções do bloco que inicia em 'instr', obtido por
+//   busca_bloco
+// para antes se uma instrução alterar o código do próprio bloco
+// para na primeira instrução que causar erro, então o estado da CPU (PC,
+//   complemento) é o mesmo que se tivessem sido executadas uma a uma
+// retorna o número de instruções executadas (incluindo a que causou erro)
+static int executa_bloco(cpu_t *self, instr_decod_t *instr, int max)
+{
+  int n = instr->n_bloco < max ? instr->n_bloco : max;
+  int executadas = 0;
+  for (;;) {
+    self->instr = instr;
+    instr->executa(self);
+    executadas++;
+    if (executadas == n || self->erro != ERR_OK) break;
+    // a próxima está logo depois desta na memória física
+    instr += instr->tam;
+    // se a instrução alterou o próprio bloco, o resto dele tem que ser
+    //   decodificado de novo
+    if (!instr->valida) break;
+  }
+  self->instr = NULL;
+  trata_erro_da_instrucao(self);
+  return executadas;
+}
+
+int cpu_executa_n(cpu_t *self, int n)
+{
+  // CPU em erro (ou parada) não executa nada; só uma interrupção muda isso,
+  //   e ela não acontece durante o lote
+  if (self->erro != ERR_OK) return n;
+
+  cpu_modo_t modo = self->modo;
+  int executadas = 0;
+  int pagina = -1, quadro = 0;
+  while (executadas < n) {
+    instr_decod_t *instr = busca_bloco(self, &pagina, &quadro);
+    bool es = instr != NULL && acessa_dispositivo(instr->opcode);
+    if (es && executadas > 0) break;
+    if (instr != NULL) {
+      executadas += executa_bloco(self, instr, n - executadas);
+    } else {
+      // a busca que falhou conta como uma instrução executada, como em
+      //   cpu_executa_1
+      trata_erro_da_instrucao(self);
+      executadas++;
+    }
+    // encerra o lote em caso de erro, interrupção (ou retorno de interrupção),
+    //   ou acesso a dispositivo
+    if (self->erro != ERR_OK || self->modo != modo || es) break;
+  }
+  return executadas;
+}
+
 
 // ---------------------------------------------------------------------
 // INTERRUPÇÃO {{{1
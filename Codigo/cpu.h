@@ -51,6 +51,16 @@ void cpu_destroi(cpu_t *self);
 //     e causa uma interrupção
 void cpu_executa_1(cpu_t *self);
 
+// executa até 'n' instruções, como se fossem 'n' chamadas a cpu_executa_1
+// retorna o número de instruções efetivamente executadas, que é menor que 'n'
+//   se a execução foi interrompida antes:
+//   - se a CPU entrar em erro ou aceitar uma interrupção, ou se mudar de modo
+//   - antes de uma instrução que acessa dispositivos (LE, ESCR, CHAMAC), a não
+//     ser que ela seja a primeira, e logo depois dela
+// quem chama deve fazer o relógio avançar o número de instruções retornado
+// se a CPU estiver em erro (ou parada), não executa nada e retorna 'n'
+int cpu_executa_n(cpu_t *self, int n);
+
 // implementa uma interrupção
 // passa para modo supervisor, salva o estado da CPU no início da memória,
 //   altera A para identificar a requisição de interrupção, altera PC para
@@ -0,0 +1,158 @@
+// disco.c
+// dispositivo de E/S que simula o tempo de acesso à memória secundária
+// simulador de computador
+// so25b
+
+#include "disco.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <assert.h>
+
+// número máximo de pedidos pendentes (e de concluídos não lidos)
+#define DISCO_MAX_PEDIDOS 64
+
+typedef struct {
+  int id;     // identificação dada por quem fez o pedido
+  int t_fim;  // quando o pedido termina (em tics)
+} pedido_t;
+
+// fila de pedidos em um vetor circular
+typedef struct {
+  pedido_t pedidos[DISCO_MAX_PEDIDOS];
+  int inicio;
+  int n;
+} fila_pedidos_t;
+
+struct disco_t {
+  // que horas são (em tics)
+  int agora;
+  int t_posicionamento;
+  int t_pagina;
+  // número de páginas do próximo pedido
+  int n_paginas;
+  // pedidos em ordem de atendimento; o primeiro é o que está sendo atendido
+  fila_pedidos_t pendentes;
+  // pedidos concluídos, ainda não lidos
+  fila_pedidos_t concluidos;
+};
+
+static bool fila_cheia(fila_pedidos_t *f)
+{
+  return f->n == DISCO_MAX_PEDIDOS;
+}
+
+static void fila_insere(fila_pedidos_t *f, pedido_t pedido)
+{
+  f->pedidos[(f->inicio + f->n) % DISCO_MAX_PEDIDOS] = pedido;
+  f->n++;
+}
+
+static pedido_t fila_retira(fila_pedidos_t *f)
+{
+  pedido_t pedido = f->pedidos[f->inicio];
+  f->inicio = (f->inicio + 1) % DISCO_MAX_PEDIDOS;
+  f->n--;
+  return pedido;
+}
+
+disco_t *disco_cria(int t_posicionamento, int t_pagina)
+{
+  disco_t *self;
+  self = malloc(sizeof(disco_t));
+  assert(self != NULL);
+
+  self->agora = 0;
+  self->t_posicionamento = t_posicionamento;
+  self->t_pagina = t_pagina;
+  self->n_paginas = 1;
+  self->pendentes.inicio = self->pendentes.n = 0;
+  self->concluidos.inicio = self->concluidos.n = 0;
+
+  return self;
+}
+
+void disco_destroi(disco_t *self)
+{
+  free(self);
+}
+
+void disco_avanca(disco_t *self, int n)
+{
+  self->agora += n;
+  // os pedidos que terminaram passam para os concluídos, se couberem
+  while (self->pendentes.n > 0 && !fila_cheia(&self->concluidos)) {
+    pedido_t *primeiro = &self->pendentes.pedidos[self->pendentes.inicio];
+    if (primeiro->t_fim > self->agora) break;
+    fila_insere(&self->concluidos, fila_retira(&self->pendentes));
+  }
+}
+
+int disco_tempo_ate_conclusao(disco_t *self)
+{
+  if (self->pendentes.n == 0) return 0;
+  int t = self->pendentes.pedidos[self->pendentes.inicio].t_fim - self->agora;
+  return t > 0 ? t : 0;
+}
+
+// coloca um pedido de 'n_paginas' no fim da fila; ele começa quando o
+//   último da fila terminar (ou agora, se a fila estiver vazia)
+static err_t disco_pede(disco_t *self, int id)
+{
+  if (fila_cheia(&self->pendentes)) return ERR_OCUP;
+  int t_ini = self->agora;
+  if (self->pendentes.n > 0) {
+    int ultimo = (self->pendentes.inicio + self->pendentes.n - 1) % DISCO_MAX_PEDIDOS;
+    if (self->pendentes.pedidos[ultimo].t_fim > t_ini) {
+      t_ini = self->pendentes.pedidos[ultimo].t_fim;
+    }
+  }
+  pedido_t pedido = {
+    .id = id,
+    .t_fim = t_ini + self->t_posicionamento + (self->n_paginas - 1) * self->t_pagina,
+  };
+  fila_insere(&self->pendentes, pedido);
+  self->n_paginas = 1;
+  return ERR_OK;
+}
+
+err_t disco_leitura(void *disp, int id, int *pvalor)
+{
+  disco_t *self = disp;
+  err_t err = ERR_OK;
+  switch (id) {
+    case 2:
+      if (self->concluidos.n == 0) {
+        *pvalor = -1;
+      } else {
+        *pvalor = fila_retira(&self->concluidos).id;
+        // pode ter aberto espaço para algum que já terminou
+        disco_avanca(self, 0);
+      }
+      break;
+    case 3:
+      *pvalor = self->concluidos.n > 0;
+      break;
+    default:
+      err = ERR_END_INV;
+  }
+  return err;
+}
+
+err_t disco_escrita(void *disp, int id, int valor)
+{
+  disco_t *self = disp;
+  err_t err = ERR_OK;
+  switch (id) {
+    case 0:
+      if (valor < 1) return ERR_OP_INV;
+      self->n_paginas = valor;
+      break;
+    case 1:
+      err = disco_pede(self, valor);
+      break;
+    default:
+      err = ERR_END_INV;
+  }
+  return err;
+}
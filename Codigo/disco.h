@@ -0,0 +1,64 @@
+// disco.h
+// dispositivo de E/S que simula o tempo de acesso à memória secundária
+// simulador de computador
+// so25b
+
+#ifndef DISCO_H
+#define DISCO_H
+
+// simulador do disco
+// a memória secundária é acessada diretamente pelo SO; este dispositivo
+//   simula o tempo das transferências, para que o SO saiba quando cada uma
+//   termina
+// recebe pedidos de transferência, identificados por um valor escolhido por
+//   quem faz o pedido, e atende um de cada vez, na ordem em que chegaram
+// cada pedido demora o tempo de posicionamento mais o tempo de transferência
+//   de cada página além da primeira
+// vários pedidos podem estar pendentes; quando um termina, vai para a lista
+//   de pedidos concluídos, e o disco pede interrupção enquanto essa lista
+//   não estiver vazia
+// tem 4 dispositivos, para:
+// - escrever o número de páginas do próximo pedido
+// - escrever um pedido (o valor escrito é a identificação do pedido)
+// - ler a identificação de um pedido concluído (-1 se não tiver), que sai
+//   da lista de concluídos
+// - ler se uma interrupção está sendo pedida pelo disco
+
+// tem 3 operações:
+// - passagem do tempo (avanca), deve ser chamada após a execução de instruções
+// - leitura de dados, a ser usada pelo controlador de E/S para acessar este
+//   dispositivo
+// - escrita de dados, a ser usada pelo controlador de E/S para acessar este
+//   dispositivo
+
+#include "err.h"
+
+typedef struct disco_t disco_t;
+
+// cria e inicializa um disco
+// 't_posicionamento' é o tempo de um pedido de uma página, 't_pagina' o de
+//   cada página a mais no mesmo pedido (em tics)
+disco_t *disco_cria(int t_posicionamento, int t_pagina);
+
+// destrói um disco
+// nenhuma outra operação pode ser realizada no disco após esta chamada
+void disco_destroi(disco_t *self);
+
+// registra a passagem de 'n' unidades de tempo
+// esta função é chamada pelo controlador após a execução de instruções
+void disco_avanca(disco_t *self, int n);
+
+// retorna o tempo até o pedido em atendimento terminar (0 se nenhum), para
+//   que o controlador não passe desse tempo em um lote de instruções
+int disco_tempo_ate_conclusao(disco_t *self);
+
+// Funções para acessar o disco como dispositivo de E/S, com id:
+//   '0' para escrever o número de páginas do próximo pedido
+//   '1' para escrever um pedido
+//   '2' para ler um pedido concluído
+//   '3' para ler se uma interrupção está sendo pedida
+// Devem seguir o protocolo f_leitura_t e f_escrita_t declarados em es.h
+err_t disco_leitura(void *disp, int id, int *pvalor);
+err_t disco_escrita(void *disp, int id, int valor);
+
+#endif // DISCO_H
@@ -33,6 +33,10 @@ typedef enum {
   D_RELOGIO_REAL,
   D_RELOGIO_TIMER,
   D_RELOGIO_INTERRUPCAO,
+  D_DISCO_TAMANHO,
+  D_DISCO_PEDIDO,
+  D_DISCO_CONCLUIDO,
+  D_DISCO_INTERRUPCAO,
   N_DISPOSITIVOS
 } dispositivo_id_t;
 
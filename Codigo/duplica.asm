@@ -0,0 +1,261 @@
+; duplica.asm
+; programa de teste da cópia na escrita (chamada SO_DUPLICA_PROC)
+; preenche um vetor que ocupa várias páginas e se duplica em NPROC processos,
+;   que compartilham as páginas; cada processo confere que recebeu o vetor
+;   preenchido, e depois, em RODADAS vezes, escreve no vetor valores que só
+;   ele usa e confere que estão lá (as escritas dos outros não podem aparecer)
+; cada processo imprime o seu número e 'ok' ou 'ERRO'; o original espera
+;   os outros terminarem antes de morrer
+
+N        define 150   ; tamanho do vetor (15 páginas)
+NPROC    define 4     ; número de processos, com o original
+RODADAS  define 5     ; quantas vezes cada processo escreve e confere
+
+         desv main
+prog     string 'duplica (cópia na escrita)  '
+
+; chamadas de sistema (ver so.h)
+SO_LE           define 1
+SO_ESCR         define 2
+SO_CRIA_PROC    define 7
+SO_MATA_PROC    define 8
+SO_ESPERA_PROC  define 9
+SO_DUPLICA_PROC define 10
+
+main
+         cargi prog
+         chama impstr
+         ; preenche o vetor antes de duplicar
+         cargi 1000
+         armm base
+         chama escreve
+         ; o original é o processo 0
+         cargi 0
+         armm num
+         ; cria os processos 1 a NPROC-1
+         cargi 1
+         armm cont
+dup1     cargi SO_DUPLICA_PROC
+         chamas
+         desvz filho       ; o processo criado recebe 0
+         desvn erro_dup
+         ; pids[cont] = pid
+         armm pid
+         cargm cont
+         trax
+         cargm pid
+         armx pids
+         ; próximo
+         cargm cont
+         soma um
+         armm cont
+         sub nproc
+         desvnz dup1
+         desv trabalho
+filho
+         ; o número do processo criado é o valor de 'cont' na duplicação
+         cargm cont
+         armm num
+
+trabalho
+         ; o vetor deve estar como antes da duplicação
+         cargi 1000
+         armm base
+         chama confere
+         desvnz falhou
+         cargi RODADAS
+         armm rodada
+rod1     ; base = num * 10000 + rodada
+         cargm num
+         mult dezmil
+         soma rodada
+         armm base
+         chama escreve
+         chama confere
+         desvnz falhou
+         cargm rodada
+         sub um
+         armm rodada
+         desvnz rod1
+         cargi msg_ok
+         desv fim
+falhou
+         cargi msg_erro
+fim
+         armm msg
+         cargm num
+         chama impnum
+         cargm msg
+         chama impstr
+         ; o original espera os outros
+         cargm num
+         desvnz morre
+         cargi 1
+         armm cont
+esp1     cargm cont
+         trax
+         cargx pids
+         trax
+         cargi SO_ESPERA_PROC
+         chamas
+         cargm cont
+         soma um
+         armm cont
+         sub nproc
+         desvnz esp1
+         desv morre
+
+erro_dup
+         cargi msg_erro_dup
+         chama impstr
+
+morre
+         cargi 0
+         trax
+         cargi SO_MATA_PROC
+         chamas
+         para
+
+; escreve no vetor: vetor[i] = base + i, para i de 0 a N-1
+escreve  espaco 1
+         cargi 0
+         trax
+esc1     cpxa
+         soma base
+         armx vetor
+         incx
+         cpxa
+         sub ene
+         desvnz esc1
+         ret escreve
+
+; confere o vetor escrito por 'escreve'
+; retorna em A 0 se está certo, 1 se não
+confere  espaco 1
+         cargi 0
+         trax
+conf1    cpxa
+         soma base
+         armm esperado
+         cargx vetor
+         sub esperado
+         desvnz conf_erro
+         incx
+         cpxa
+         sub ene
+         desvnz conf1
+         cargi 0
+         ret confere
+conf_erro
+         cargi 1
+         ret confere
+
+; imprime a string que inicia em A (destroi X)
+impstr   espaco 1
+         trax
+impstr1
+         cargx 0
+         desvz impstrf
+         chama impch
+         incx
+         desv impstr1
+impstrf  ret impstr
+
+; função que chama o SO para imprimir o caractere em A
+; retorna em A o código de erro do SO
+; não altera o valor de X
+impch    espaco 1
+         trax
+         armm impch_X
+         cargi SO_ESCR
+         chamas
+         trax
+         cargm impch_X
+         trax
+         ret impch
+impch_X  espaco 1 ; para salvar o valor de X
+
+; escreve o valor de A no terminal, em decimal
+impnum  espaco 1
+        ; ei_num = A
+        armm ei_num
+        ; if ei_num > 0 goto ei_pos
+        desvp ei_pos
+        ; if ei_num < 0 goto ei_neg
+        desvn ei_neg
+        ; print '0'; goto ei_f
+        cargi '0'
+        chama impch
+        desv ei_f
+ei_neg
+        ; ei_num = -ei_num
+        neg
+        armm ei_num
+        ; print '-'
+        cargi '-'
+        chama impch
+ei_pos
+        ; faz ei_mul ser a maior potência de 10 <= ei_num
+        ; ei_mul = 1
+        cargi 1
+        armm ei_mul
+ei_1
+        ; if ei_mul == ei_num goto ei_3
+        cargm ei_mul
+        sub ei_num
+        desvz ei_3
+        ; if ei_mul > ei_num goto ei_2
+        desvp ei_2
+        ; ei_mul *= 10
+        cargm ei_mul
+        mult dez
+        armm ei_mul
+        ; goto ei_1
+        desv ei_1
+ei_2
+        ; ei_mul /= 10
+        cargm ei_mul
+        div dez
+        armm ei_mul
+ei_3
+        ; print (ei_num/ei_mul) % 10 + '0'
+        cargm ei_num
+        div ei_mul
+        resto dez
+        soma a_zero
+        chama impch
+        ; ei_mul /= 10
+        cargm ei_mul
+        div dez
+        armm ei_mul
+        ; if ei_mul > 0 goto ei_3
+        desvp ei_3
+ei_f
+        ; print ' '
+        cargi ' '
+        chama impch
+        ; return
+        ret impnum
+ei_num  espaco 1
+ei_mul  espaco 1
+a_zero  valor '0'
+dez     valor 10
+
+
+; variáveis
+num      espaco 1     ; número deste processo (0 é o original)
+cont     espaco 1
+pid      espaco 1
+pids     espaco NPROC
+base     espaco 1
+rodada   espaco 1
+esperado espaco 1
+msg      espaco 1
+msg_ok   string 'ok '
+msg_erro string 'ERRO '
+msg_erro_dup string 'ERRO na duplicação '
+um       valor 1
+nproc    valor NPROC
+ene      valor N
+dezmil   valor 10000
+vetor    espaco N
@@ -18,6 +18,7 @@ typedef enum {
   // interrupções de E/S ainda não implementadas
   IRQ_TECLADO,       // interrupção causada pelo teclado
   IRQ_TELA,          // interrupção causada pela tela
+  IRQ_DISCO,         // interrupção causada pelo disco (transferência concluída)
   N_IRQ              // número de interrupções
 } irq_t;
 
@@ -9,6 +9,7 @@
 #include "mmu.h"
 #include "cpu.h"
 #include "relogio.h"
+#include "disco.h"
 #include "console.h"
 #include "terminal.h"
 #include "es.h"
@@ -17,6 +18,16 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+// menor número de quadros da memória principal para os processos (além dos
+//   que contêm a memória protegida) aceito em '-m'
+// com menos, os programas de exemplo disputam tanto os quadros que cada
+//   página é substituída antes de o processo que a pediu voltar a executar,
+//   e a execução não termina
+#define MEM_QUADROS_MIN 10
+#define MEM_TAM_MIN ((CPU_END_FIM_PROT / TAM_PAGINA + 1 + MEM_QUADROS_MIN) * TAM_PAGINA)
 
 // estrutura com os componentes do computador simulado
 typedef struct {
@@ -25,11 +36,32 @@ typedef struct {
   mmu_t *mmu;
   cpu_t *cpu;
   relogio_t *relogio;
+  disco_t *disco;
   console_t *console;
   es_t *es;
   controle_t *controle;
 } hardware_t;
 
+// configuração da simulação, definida pelos argumentos da linha de comando
+typedef struct {
+  // false para executar em lote, sem tela
+  bool com_tela;
+  // arquivo com os comandos do operador, quando sem tela
+  FILE *comandos;
+  // início do nome dos arquivos gerados
+  char *prefixo;
+  // tamanho da memória principal (de MEM_TAM_MIN a MEM_TAM, em páginas inteiras)
+  int mem_tam;
+  // algoritmo de substituição de páginas e controle da frequência de falhas
+  //   (ver so_cria)
+  int algoritmo_substituicao;
+  bool controle_pff;
+  // programa do primeiro processo
+  char *programa_inicial;
+  // máximo de instruções entre dois atendimentos à console (0 para o padrão)
+  int max_lote;
+} config_t;
+
 
 // registra no controlador de es os 4 dispositivos do terminal 'id_term'
 //   da console, com valores a partir de n_disp
@@ -78,18 +110,20 @@ static void inicializa_rom(mem_t *mem)
   prog_destroi(prog);
 }
 
-static void cria_hardware(hardware_t *hw)
+static void cria_hardware(hardware_t *hw, config_t *cfg)
 {
   // cria a memória
-  hw->mem = mem_cria(MEM_TAM);
+  hw->mem = mem_cria(cfg->mem_tam);
   inicializa_rom(hw->mem);
   // cria a MMU
   hw->mmu = mmu_cria(hw->mem);
+  // a memória secundária não diminui com a principal, tem que caber os programas
   hw->mem_sec = mem_cria(5 * MEM_TAM);
 
   // cria dispositivos de E/S
-  hw->console = console_cria();
+  hw->console = console_cria(cfg->com_tela, cfg->comandos, cfg->prefixo);
   hw->relogio = relogio_cria();
+  hw->disco = disco_cria(ESPERA_ACESSO_SECUNDARIA, ESPERA_PAGINA_LOTE);
 
   // cria o controlador de E/S e registra os dispositivos
   //   por exemplo, o dispositivo 8 do controlador de E/S (e da CPU) será o
@@ -105,13 +139,19 @@ static void cria_hardware(hardware_t *hw)
   es_registra_dispositivo(hw->es, D_RELOGIO_REAL      , hw->relogio, 1, relogio_leitura, NULL);
   es_registra_dispositivo(hw->es, D_RELOGIO_TIMER     , hw->relogio, 2, relogio_leitura, relogio_escrita);
   es_registra_dispositivo(hw->es, D_RELOGIO_INTERRUPCAO,hw->relogio, 3, relogio_leitura, relogio_escrita);
+  // registra os 4 dispositivos do disco
+  es_registra_dispositivo(hw->es, D_DISCO_TAMANHO     , hw->disco, 0, NULL, disco_escrita);
+  es_registra_dispositivo(hw->es, D_DISCO_PEDIDO      , hw->disco, 1, NULL, disco_escrita);
+  es_registra_dispositivo(hw->es, D_DISCO_CONCLUIDO   , hw->disco, 2, disco_leitura, NULL);
+  es_registra_dispositivo(hw->es, D_DISCO_INTERRUPCAO , hw->disco, 3, disco_leitura, NULL);
 
   // cria a unidade de execução e inicializa com a MMU e o controlador de E/S
   hw->cpu = cpu_cria(hw->mmu, hw->es);
 
   // cria o controlador da CPU e inicializa com a unidade de execução, a console e
-  //   o relógio
-  hw->controle = controle_cria(hw->cpu, hw->console, hw->relogio);
+  //   os dispositivos que geram interrupção (relógio e disco)
+  hw->controle = controle_cria(hw->cpu, hw->console, hw->relogio, hw->disco);
+  if (cfg->max_lote > 0) controle_define_lote(hw->controle, cfg->max_lote);
 }
 
 static void destroi_hardware(hardware_t *hw)
@@ -120,27 +160,110 @@ static void destroi_hardware(hardware_t *hw)
   cpu_destroi(hw->cpu);
   es_destroi(hw->es);
   relogio_destroi(hw->relogio);
+  disco_destroi(hw->disco);
   console_destroi(hw->console);
   mmu_destroi(hw->mmu);
   mem_destroi(hw->mem);
-  //mem_destroi(hw->mem_sec);
+  mem_destroi(hw->mem_sec);
+}
+
+static void verifica_args(int argc, char *argv[argc], config_t *cfg)
+{
+  cfg->com_tela = true;
+  cfg->comandos = NULL;
+  cfg->prefixo = "";
+  cfg->mem_tam = MEM_TAM;
+  cfg->algoritmo_substituicao = 1;
+  cfg->controle_pff = false;
+  cfg->programa_inicial = "init.maq";
+  cfg->max_lote = 0;
+  for (int argi = 1; argi < argc; argi++) {
+    if (strcmp(argv[argi], "-b") == 0) {
+      cfg->com_tela = false;
+    } else if (strcmp(argv[argi], "-c") == 0 && argi + 1 < argc) {
+      argi++;
+      if (strcmp(argv[argi], "-") == 0) {
+        cfg->comandos = stdin;
+      } else {
+        cfg->comandos = fopen(argv[argi], "r");
+        if (cfg->comandos == NULL) {
+          fprintf(stderr, "ERRO: não consegui abrir '%s'\n", argv[argi]);
+          exit(1);
+        }
+      }
+    } else if (strcmp(argv[argi], "-o") == 0 && argi + 1 < argc) {
+      argi++;
+      cfg->prefixo = argv[argi];
+    } else if (strcmp(argv[argi], "-m") == 0 && argi + 1 < argc) {
+      argi++;
+      cfg->mem_tam = atoi(argv[argi]);
+      if (cfg->mem_tam < MEM_TAM_MIN || cfg->mem_tam > MEM_TAM
+          || cfg->mem_tam % TAM_PAGINA != 0) {
+        fprintf(stderr, "ERRO: a memória deve ter de %d a %d palavras, múltiplo de %d\n",
+                MEM_TAM_MIN, MEM_TAM, TAM_PAGINA);
+        exit(1);
+      }
+    } else if (strcmp(argv[argi], "-s") == 0 && argi + 1 < argc) {
+      argi++;
+      cfg->algoritmo_substituicao = atoi(argv[argi]);
+      if (cfg->algoritmo_substituicao < 1 || cfg->algoritmo_substituicao > 5) {
+        fprintf(stderr, "ERRO: algoritmo de substituição deve ser de 1 a 5\n");
+        exit(1);
+      }
+    } else if (strcmp(argv[argi], "-p") == 0) {
+      cfg->controle_pff = true;
+    } else if (strcmp(argv[argi], "-i") == 0 && argi + 1 < argc) {
+      argi++;
+      cfg->programa_inicial = argv[argi];
+    } else if (strcmp(argv[argi], "-l") == 0 && argi + 1 < argc) {
+      argi++;
+      cfg->max_lote = atoi(argv[argi]);
+      if (cfg->max_lote < 1) {
+        fprintf(stderr, "ERRO: o lote deve ter pelo menos 1 instrução\n");
+        exit(1);
+      }
+    } else {
+      fprintf(stderr, "ERRO: chame como '%s [-b [-c comandos] [-o prefixo]] [-m palavras] [-s algoritmo] [-p] [-i programa] [-l instruções]'\n"
+                      "  -b  executa em lote, sem tela, até não ter mais processos\n"
+                      "      (ou até um erro interno do SO, que faz o programa terminar com erro)\n"
+                      "  -c  lê os comandos da console do arquivo ('-' para a entrada padrão)\n"
+                      "  -o  prefixo do nome dos arquivos gerados (log e saída dos terminais)\n"
+                      "  -m  tamanho da memória principal, múltiplo de %d, de %d a %d (padrão)\n"
+                      "  -s  substituição de páginas: 1 FIFO (padrão), 2 LRU, 3 CLOCK,\n"
+                      "      4 CLOCK com bit de alteração, 5 WSClock\n"
+                      "  -p  controla a quota de quadros de cada processo pela frequência de\n"
+                      "      falhas de página, suspendendo processos quando falta memória\n"
+                      "  -i  programa do primeiro processo (padrão init.maq)\n"
+                      "  -l  máximo de instruções executadas entre dois atendimentos à console\n"
+                      "      (1 executa uma instrução por vez)\n",
+                      argv[0], TAM_PAGINA, MEM_TAM_MIN, MEM_TAM);
+      exit(1);
+    }
+  }
 }
 
-int main()
+int main(int argc, char *argv[argc])
 {
   hardware_t hw;
+  config_t cfg;
   so_t *so;
 
+  verifica_args(argc, argv, &cfg);
+
   // cria o hardware
-  cria_hardware(&hw);
+  cria_hardware(&hw, &cfg);
   // cria o sistema operacional
-  so = so_cria(hw.cpu, hw.mem, hw.mmu, hw.es, hw.console, hw.mem_sec);
+  so = so_cria(hw.cpu, hw.mem, hw.mmu, hw.es, hw.console, hw.mem_sec,
+               cfg.algoritmo_substituicao, cfg.controle_pff, cfg.programa_inicial);
 
   // executa o laço principal do controlador
   controle_laco(hw.controle);
+  bool falhou = console_sistema_falhou(hw.console);
 
   // destroi tudo
   so_destroi(so);
   destroi_hardware(&hw);
+  if (cfg.comandos != NULL && cfg.comandos != stdin) fclose(cfg.comandos);
+  return falhou ? 1 : 0;
 }
 
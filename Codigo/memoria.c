@@ -12,6 +12,9 @@
 struct mem_t {
   int tam;
   int *conteudo;
+  // quem deve ser avisado das escritas
+  f_observa_escrita_t observador;
+  void *arg_observador;
 };
 
 
@@ -27,6 +30,8 @@ mem_t *mem_cria(int tam)
   assert(self->conteudo != NULL);
 
   self->tam = tam;
+  self->observador = NULL;
+  self->arg_observador = NULL;
 
   return self;
 }
@@ -69,6 +74,15 @@ err_t mem_escreve(mem_t *self, int endereco, int valor)
   err_t err = verifica_permissao(self, endereco);
   if (err == ERR_OK) {
     self->conteudo[endereco] = valor;
+    if (self->observador != NULL) {
+      self->observador(self->arg_observador, endereco);
+    }
   }
   return err;
 }
+
+void mem_define_observador(mem_t *self, f_observa_escrita_t func, void *arg)
+{
+  self->observador = func;
+  self->arg_observador = arg;
+}
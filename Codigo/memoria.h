@@ -13,6 +13,9 @@
 //
 // O único erro possível no acesso é uma tentativa de acesso a uma posição
 //   inexistente
+//
+// Quem mantém cópias derivadas do conteúdo da memória (a CPU mantém instruções
+//   pré-decodificadas) pode pedir para ser avisado de cada escrita.
 
 #ifndef MEMORIA_H
 #define MEMORIA_H
@@ -22,6 +25,10 @@
 // tipo opaco que representa a memória
 typedef struct mem_t mem_t;
 
+// tipo da função chamada após cada escrita bem sucedida na memória
+//   recebe o argumento registrado e o endereço alterado
+typedef void (*f_observa_escrita_t)(void *arg, int endereco);
+
 // cria uma região de memória com capacidade para 'tam' valores (inteiros)
 // retorna um ponteiro para um descritor, que deverá ser usado em todas
 //   as operações sobre essa memória
@@ -42,4 +49,8 @@ err_t mem_le(mem_t *self, int endereco, int *pvalor);
 // retorna erro ERR_END_INV se endereço inválido
 err_t mem_escreve(mem_t *self, int endereco, int valor);
 
+// define a função a ser chamada após cada escrita na memória, e o argumento
+//   a passar para ela; se 'func' for NULL, ninguém é avisado
+void mem_define_observador(mem_t *self, f_observa_escrita_t func, void *arg);
+
 #endif // MEMORIA_H
@@ -7,14 +7,83 @@
 #include <stdlib.h>
 #include <assert.h>
 
+// número de entradas da TLB (mapeamento direto, indexada pelo espaço de
+//   endereçamento e pelo número da página)
+// t3: pode ser alterado para comparar o alcance da TLB (TLB_N_ENTRADAS * TAM_PAGINA)
+#define TLB_N_ENTRADAS 64
+// cada espaço de endereçamento começa a ocupar a TLB em uma posição diferente,
+//   para que as traduções de processos diferentes não disputem as mesmas
+//   entradas; com os valores acima, as traduções de 4 processos cabem juntas
+#define TLB_ENTRADAS_POR_ASID 16
+
+// uma entrada da TLB, com uma tradução copiada da tabela de páginas
+typedef struct {
+  bool valida;
+  // versão da tabela de páginas de onde a tradução foi copiada
+  //   (ver tabpag_versao); uma tradução de uma tabela destruída não vale,
+  //   mesmo que outra tabela tenha o mesmo asid
+  // alterações de páginas são avisadas pela tabela (ver mmu__aviso_tabpag)
+  unsigned versao;
+  // espaço de endereçamento (ver tabpag_asid) e página traduzida
+  int asid;
+  int pagina;
+  int quadro;
+  // proteção da página (ver tabpag_protecao)
+  int protecao;
+  // os bits de acesso e alteração já foram marcados na tabela de páginas
+  // só é necessário alterar a tabela quando um desses bits muda
+  bool acessada;
+  bool alterada;
+} entrada_tlb_t;
+
 // tipo de dados opaco para representar uma MMU
 struct mmu_t {
   // memória física
   mem_t *mem;
   // tabela de páginas
   tabpag_t *tabpag;
+  // identificador do espaço de endereçamento da tabela de páginas
+  int asid;
+  // cache de traduções da tabela de páginas
+  entrada_tlb_t tlb[TLB_N_ENTRADAS];
+  // estatísticas da TLB
+  long tlb_acertos;
+  long tlb_faltas;
 };
 
+// esvazia a TLB
+static void mmu__esvazia_tlb(mmu_t *self)
+{
+  for (int i = 0; i < TLB_N_ENTRADAS; i++) {
+    self->tlb[i].valida = false;
+  }
+}
+
+// índice na TLB da tradução da página 'pagina' do espaço de endereçamento 'asid'
+static int mmu__indice_tlb(int asid, int pagina)
+{
+  unsigned indice = (unsigned)asid * TLB_ENTRADAS_POR_ASID + (unsigned)pagina;
+  return indice % TLB_N_ENTRADAS;
+}
+
+// chamada pela tabela de páginas quando uma página é alterada (ver
+//   tabpag_define_aviso)
+// descarta só a tradução dessa página; se só os bits de acesso e alteração
+//   foram zerados, mantém a tradução, mas esquece que os bits já estão
+//   marcados, para que o próximo acesso os marque de novo
+static void mmu__aviso_tabpag(void *arg, int asid, int pagina, bool so_bits)
+{
+  mmu_t *self = arg;
+  entrada_tlb_t *entrada = &self->tlb[mmu__indice_tlb(asid, pagina)];
+  if (!entrada->valida || entrada->asid != asid || entrada->pagina != pagina) return;
+  if (so_bits) {
+    entrada->acessada = false;
+    entrada->alterada = false;
+  } else {
+    entrada->valida = false;
+  }
+}
+
 mmu_t *mmu_cria(mem_t *mem)
 {
   mmu_t *self;
@@ -22,6 +91,10 @@ mmu_t *mmu_cria(mem_t *mem)
   assert(self != NULL);
   self->mem = mem;
   self->tabpag = NULL;
+  self->asid = 0;
+  mmu__esvazia_tlb(self);
+  self->tlb_acertos = 0;
+  self->tlb_faltas = 0;
   return self;
 }
 
@@ -33,58 +106,116 @@ void mmu_destroi(mmu_t *self)
   }
 }
 
+mem_t *mmu_mem(mmu_t *self)
+{
+  return self->mem;
+}
+
 void mmu_define_tabpag(mmu_t *self, tabpag_t *tabpag)
 {
+  // a TLB não é esvaziada: as entradas de cada espaço de endereçamento são
+  //   identificadas pelo asid, as de páginas alteradas são descartadas pelo
+  //   aviso da tabela, e as de tabelas destruídas não são mais usadas,
+  //   porque a versão não confere
+  // a tabela continua avisando esta MMU depois de trocada por outra, porque
+  //   a TLB pode ter traduções dela
   self->tabpag = tabpag;
+  if (tabpag != NULL) {
+    self->asid = tabpag_asid(tabpag);
+    tabpag_define_aviso(tabpag, mmu__aviso_tabpag, self);
+  }
 }
 
-// traduz o endereço virtual 'endvirt', colocando o endereço físico
-//   correspondente em 'pendfis'.
-// retorna ERR_OK ou um erro se a tradução não for possível
-static err_t mmu__traduz(mmu_t *self, int endvirt, int *pendfis)
+void mmu_estatisticas_tlb(mmu_t *self, long *pacertos, long *pfaltas)
 {
-  int pagina = endvirt / TAM_PAGINA;
-  int deslocamento = endvirt % TAM_PAGINA;
-  int quadro;
-  err_t err = tabpag_traduz(self->tabpag, pagina, &quadro);
-  if (err == ERR_OK) {
-    *pendfis = quadro * TAM_PAGINA + deslocamento;
+  *pacertos = self->tlb_acertos;
+  *pfaltas = self->tlb_faltas;
+}
+
+// obtém a entrada da TLB com a tradução da página 'pagina', consultando a
+//   tabela de páginas se a tradução não estiver na TLB
+// retorna NULL se a tradução não for possível
+static entrada_tlb_t *mmu__entrada_tlb(mmu_t *self, int pagina)
+{
+  entrada_tlb_t *entrada = &self->tlb[mmu__indice_tlb(self->asid, pagina)];
+  unsigned versao = tabpag_versao(self->tabpag);
+  if (entrada->valida && entrada->asid == self->asid
+      && entrada->pagina == pagina && entrada->versao == versao) {
+    self->tlb_acertos++;
+    return entrada;
   }
-  return err;
+  self->tlb_faltas++;
+  int quadro;
+  if (tabpag_traduz(self->tabpag, pagina, &quadro) != ERR_OK) return NULL;
+  entrada->valida = true;
+  entrada->versao = versao;
+  entrada->asid = self->asid;
+  entrada->pagina = pagina;
+  entrada->quadro = quadro;
+  entrada->protecao = tabpag_protecao(self->tabpag, pagina);
+  entrada->acessada = false;
+  entrada->alterada = false;
+  return entrada;
 }
 
-err_t mmu_le(mmu_t *self, int endvirt, int *pvalor, cpu_modo_t modo)
+// traduz o endereço virtual 'endvirt' (ou não, dependendo do modo e da
+//   existência de tabela de páginas), colocando o endereço físico
+//   correspondente em 'pendfis'
+// 'acesso' é o tipo de acesso (0 para leitura, TABPAG_ESCRITA ou
+//   TABPAG_EXECUCAO), que deve ser permitido pela proteção da página
+// se o acesso for possível, marca a página como acessada (e alterada,
+//   se for escrita)
+// retorna ERR_OK ou um erro se a tradução não for possível
+static err_t mmu__acessa(mmu_t *self, int endvirt, int *pendfis,
+                         cpu_modo_t modo, int acesso)
 {
   // em modo supervisor ou se não tiver tabela de páginas,
   //   não faz tradução de endereços, nem marca o acesso
   if (modo == supervisor || self->tabpag == NULL) {
-    return mem_le(self->mem, endvirt, pvalor);
+    if (endvirt < 0 || endvirt >= mem_tam(self->mem)) return ERR_END_INV;
+    *pendfis = endvirt;
+    return ERR_OK;
+  }
+  int pagina = endvirt / TAM_PAGINA;
+  int deslocamento = endvirt % TAM_PAGINA;
+  entrada_tlb_t *entrada = mmu__entrada_tlb(self, pagina);
+  if (entrada == NULL) return ERR_PAG_AUSENTE;
+  if ((entrada->protecao & acesso) != acesso) return ERR_PAG_PROTEGIDA;
+  int endfis = entrada->quadro * TAM_PAGINA + deslocamento;
+  // o acesso só é bem sucedido se o endereço existir na memória
+  if (endfis < 0 || endfis >= mem_tam(self->mem)) return ERR_END_INV;
+  // só altera a tabela se algum bit for mudar
+  bool escrita = (acesso == TABPAG_ESCRITA);
+  if (!entrada->acessada || (escrita && !entrada->alterada)) {
+    tabpag_marca_bit_acesso(self->tabpag, pagina, escrita);
+    entrada->acessada = true;
+    if (escrita) entrada->alterada = true;
   }
+  *pendfis = endfis;
+  return ERR_OK;
+}
+
+err_t mmu_traduz(mmu_t *self, int endvirt, int *pendfis, cpu_modo_t modo)
+{
+  return mmu__acessa(self, endvirt, pendfis, modo, TABPAG_EXECUCAO);
+}
+
+err_t mmu_le(mmu_t *self, int endvirt, int *pvalor, cpu_modo_t modo)
+{
   int endfis;
-  err_t err = mmu__traduz(self, endvirt, &endfis);
+  err_t err = mmu__acessa(self, endvirt, &endfis, modo, 0);
   if (err == ERR_OK) {
     err = mem_le(self->mem, endfis, pvalor);
-    if (err == ERR_OK) {
-      tabpag_marca_bit_acesso(self->tabpag, endvirt / TAM_PAGINA, false);
-    }
   }
   return err;
 }
 
 err_t mmu_escreve(mmu_t *self, int endvirt, int valor, cpu_modo_t modo)
 {
-  // em modo supervisor ou se não tiver tabela de páginas,
-  //   não faz tradução de endereços, nem marca o acesso
-  if (modo == supervisor || self->tabpag == NULL) {
-    return mem_escreve(self->mem, endvirt, valor);
-  }
   int endfis;
-  err_t err = mmu__traduz(self, endvirt, &endfis);
+  err_t err = mmu__acessa(self, endvirt, &endfis, modo, TABPAG_ESCRITA);
   if (err == ERR_OK) {
     err = mem_escreve(self->mem, endfis, valor);
-    if (err == ERR_OK) {
-      tabpag_marca_bit_acesso(self->tabpag, endvirt / TAM_PAGINA, true);
-    }
   }
   return err;
 }
@@ -34,10 +34,28 @@ mmu_t *mmu_cria(mem_t *mem);
 // nenhuma outra operação pode ser realizada na MMU após esta chamada
 void mmu_destroi(mmu_t *self);
 
+// retorna a memória física gerenciada pela MMU
+mem_t *mmu_mem(mmu_t *self);
+
 // define a tabela de páginas a usar nas próximas traduções
 // se tabpag for NULL, os acessos serão repassados à memória sem alteração
+// a troca é barata: a TLB não é esvaziada, as traduções são identificadas
+//   pelo espaço de endereçamento da tabela (ver tabpag_asid), e as traduções
+//   de uma página continuam válidas enquanto ela não for alterada
 void mmu_define_tabpag(mmu_t *self, tabpag_t *tabpag);
 
+// a MMU mantém uma TLB, uma cache com as últimas traduções feitas, para
+//   evitar consultas à tabela de páginas
+// a tradução de uma página na TLB é descartada quando essa página é alterada
+//   na tabela (ver tabpag_define_aviso); zerar os bits de acesso ou alteração
+//   não descarta a tradução
+// cada tabela recebida em mmu_define_tabpag passa a avisar esta MMU, então
+//   uma tabela não pode ser usada por duas MMUs, e não pode ser alterada
+//   depois que a MMU for destruída
+// coloca em '*pacertos' e '*pfaltas' o número de traduções encontradas
+//   e não encontradas na TLB desde a criação da MMU
+void mmu_estatisticas_tlb(mmu_t *self, long *pacertos, long *pfaltas);
+
 // coloca na posição apontada por 'pvalor' o valor que está na memória
 //   no endereço físico correspondente ao endereço virtual 'endvirt'
 // marca a página como acessada se o acesso for bem sucedido
@@ -48,11 +66,20 @@ void mmu_define_tabpag(mmu_t *self, tabpag_t *tabpag);
 //   à memória sem tradução
 err_t mmu_le(mmu_t *self, int endvirt, int *pvalor, cpu_modo_t modo);
 
+// coloca em 'pendfis' o endereço físico correspondente ao endereço virtual
+//   'endvirt', com os mesmos efeitos e erros de uma leitura (ver mmu_le), mas
+//   sem acessar o conteúdo da memória
+// usado pela CPU na busca de instruções, para poder usar instruções já
+//   decodificadas a partir do endereço físico; por isso, retorna
+//   ERR_PAG_PROTEGIDA se a página não permitir execução (TABPAG_EXECUCAO)
+err_t mmu_traduz(mmu_t *self, int endvirt, int *pendfis, cpu_modo_t modo);
+
 // coloca 'valor' no endereço físico da memória correspondente ao endereço
 //   virtual 'endvirt'
 // marca a página como acessada e alterada se o acesso for bem sucedido
 // retorna erro se acesso não for possível, por um erro de tradução
-//   (ver tabpag_traduz) ou de memória (ver mem_escreve)
+//   (ver tabpag_traduz) ou de memória (ver mem_escreve), ou ERR_PAG_PROTEGIDA
+//   se a página não permitir escrita (TABPAG_ESCRITA)
 // se o acesso for feito em modo supervisor, ou se a mmu não tiver tabela de
 //   página definida, trata 'endvirt' como endereço físico: repassa o acesso
 //   à memória sem tradução
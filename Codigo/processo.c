@@ -3,7 +3,7 @@
 #include "processo.h"
 #include "mmu.h"
 
-void inicializa_processo(processo_t* processo, int id, int PC, int tam){
+void inicializa_processo(processo_t* processo, int id, int PC, int tam, int asid){
     if (PC < 0) {
         console_printf("SO: endereco PC invalido");
         return;
@@ -22,8 +22,22 @@ void inicializa_processo(processo_t* processo, int id, int PC, int tam){
     processo->id_terminal = (id % 4) * 4;     //0-3, 4-7, 8-11, 12-15
     processo->espera = 0;     //Sem espera = 0, Le = 1, Escreve = 2, Acesso a disco = 3
     processo->quantum = QUANTUM_INICIAL;
-    processo->tab_pag = tabpag_cria();
+    processo->tab_pag = tabpag_cria(asid);
     processo->n_falha_paginas = 0;
+    processo->n_paginas_adiantadas = 0;
+    processo->t_espera_disco = 0;
+    processo->inicio_espera_disco = 0;
+    processo->pedido_disco = -1;
+    for(int s = 0; s < SEQUENCIAS_POR_PROCESSO; s++){
+        processo->seq_ultima_falha[s] = -1;
+        processo->seq_n_adiantar[s] = 0;
+    }
+    processo->n_quadros = 0;
+    processo->quota_quadros = 0;
+    processo->pff_inicio_janela = 0;
+    processo->pff_falhas_inicio = 0;
+    processo->imagem = -1;
+    processo->end_sec_pagina = NULL;
     if(tam % TAM_PAGINA == 0)
         processo->n_paginas = tam/TAM_PAGINA;
     else
@@ -45,16 +59,17 @@ void altera_estado_proc_tabela(processo_t processos[MAX_PROCESSOS], int id, esta
     }
 }
 
-static char *nomes_estados[3] = {
+static char *nomes_estados[TIPOS_ESTADOS] = {
   [bloqueado] =   "Bloqueado",
   [pronto] = "Pronto",
   [morto] = "Morto",
+  [suspenso] = "Suspenso",
 };
 
 // retorna o nome da interrupção
 char *estado_nome(estado_proc est)
 {
-  if (est < 0 || est > 3) return "DESCONHECIDA";
+  if (est < 0 || est >= TIPOS_ESTADOS) return "DESCONHECIDA";
   return nomes_estados[est];
 }
 
@@ -6,8 +6,11 @@
 
 #define INI_MEM_PROC 100
 #define MAX_PROCESSOS 4 //número máximo de processos
+#define SEQUENCIAS_POR_PROCESSO 2 //sequências de falhas de página acompanhadas (código e dados)
 
-typedef enum { bloqueado, pronto, morto } estado_proc;
+// um processo suspenso teve todos os seus quadros liberados por falta de
+//   memória, e só volta a ser pronto pelo escalonador de médio prazo
+typedef enum { bloqueado, pronto, morto, suspenso } estado_proc;
 
 struct processo_t{
     int id;
@@ -18,7 +21,7 @@ struct processo_t{
     err_t erro;
     int memIni;
     int memTam;
-    int t_cpu;
+    int t_cpu;        //instruções executadas pelo processo (tempo virtual)
     int n_exec;
     estado_proc estado;
     float prio;
@@ -26,9 +29,23 @@ struct processo_t{
     int espera;
     int quantum;
     tabpag_t *tab_pag;
-    int pos_ini_mem_sec;
     int n_paginas;    //número de páginas do processo, nao acessivel pela tabela
     int n_falha_paginas;  //contador de falha de página (métricas)
+    int n_paginas_adiantadas; //páginas trazidas junto com a da falha (métricas)
+    int t_espera_disco;   //instruções bloqueado esperando o disco (métricas)
+    int inicio_espera_disco;  //instante em que bloqueou esperando o disco
+    int pedido_disco;     //pedido ao disco pelo qual o processo espera (-1 se nenhum)
+    //página da última falha de cada sequência de acessos, a mais recente
+    //  primeiro (-1 se nenhuma), e páginas a adiantar na próxima falha dela
+    int seq_ultima_falha[SEQUENCIAS_POR_PROCESSO];
+    int seq_n_adiantar[SEQUENCIAS_POR_PROCESSO];
+    int n_quadros;        //quadros da memória principal que o processo usa (conjunto residente)
+    int quota_quadros;    //máximo de quadros do processo, ajustado pela frequência de falhas
+    int pff_inicio_janela;  //tempo virtual do início da janela de contagem de falhas
+    int pff_falhas_inicio;  //n_falha_paginas no início da janela
+    int imagem;           //imagem do programa na tabela de imagens do SO (-1 se nenhuma)
+    int *end_sec_pagina;  //endereço na memória secundária de cada página que o processo
+                          //alterou e salvou (-1 para as que estão como na imagem)
 };
 typedef struct processo_t processo_t;
 
@@ -40,9 +57,11 @@ struct lista_processos {
 };
 typedef struct lista_processos Lista_processos;
 
-#define TIPOS_ESTADOS 3
+#define TIPOS_ESTADOS 4
 
-void inicializa_processo(processo_t* processo, int id, int PC, int tam);
+// 'asid' identifica o espaço de endereçamento do processo na MMU; é a
+//   entrada do processo na tabela de processos, única entre os vivos
+void inicializa_processo(processo_t* processo, int id, int PC, int tam, int asid);
 int encontra_indice_processo(processo_t processos[MAX_PROCESSOS], int id);
 void altera_estado_proc_tabela(processo_t processos[MAX_PROCESSOS], int id, estado_proc estado);
 char *estado_nome(estado_proc est);
@@ -36,6 +36,10 @@ void relogio_destroi(relogio_t *self);
 // esta função é chamada pelo controlador após a execução de cada instrução
 void relogio_tictac(relogio_t *self);
 
+// registra a passagem de 'n' unidades de tempo, como 'n' chamadas a
+//   relogio_tictac; o controlador usa quando executa instruções em lote
+void relogio_avanca(relogio_t *self, int n);
+
 // Funções para acessar o relógio como dispositivo de E/S, com id:
 //   '0' para ler o relógio local (contador de instruções)
 //   '1' para ler o tempo de CPU consumido pelo simulador (em ms)
@@ -20,6 +20,9 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <limits.h>
+#include <string.h>
+#include <assert.h>
 
 
 // ---------------------------------------------------------------------
@@ -28,6 +31,38 @@
 
 // intervalo entre interrupções do relógio
 #define INTERVALO_INTERRUPCAO 50   // em instruções executadas
+// porcentagem dos quadros visitados para o envelhecimento (LRU) a cada
+//   interrupção do relógio; os quadros são visitados em rodízio
+// t3: pode ser diminuído para limitar o custo da interrupção com memórias grandes
+#define ENVELHECIMENTO_PERCENTUAL 100
+// janela do conjunto de trabalho para o WSClock, em instruções executadas
+//   pelo processo (tempo virtual); uma página que o processo não acessou
+//   nesse intervalo está fora do conjunto de trabalho, e pode ser substituída
+#define JANELA_CONJUNTO_TRABALHO 500
+// no WSClock, os quadros de um processo que tem até esse número de quadros
+//   contam como dentro do conjunto de trabalho, para que um processo grande
+//   não tire todos os quadros dos outros
+#define MIN_QUADROS_RESIDENTES 2
+// controle da frequência de falhas de página (PFF, ver so_pff_avalia)
+// a cada PFF_JANELA instruções executadas por um processo, se ele teve mais
+//   que PFF_MAX_FALHAS falhas de página a sua quota de quadros aumenta, se
+//   teve menos que PFF_MIN_FALHAS diminui
+#define PFF_JANELA 200
+#define PFF_MAX_FALHAS 4
+#define PFF_MIN_FALHAS 1
+#define PFF_QUOTA_INICIAL 4
+// uma instrução pode precisar de 3 quadros (2 do código e um do dado)
+#define PFF_QUOTA_MIN 3
+// pré-paginação: em uma falha de página, algumas das páginas seguintes à da
+//   falha são trazidas na mesma transferência, se tiver quadros livres
+// o número de páginas começa em PAGINAS_ADIANTADAS, dobra (até
+//   PAGINAS_ADIANTADAS_MAX) a cada falha que continua uma sequência e diminui
+//   de um (até PAGINAS_ADIANTADAS_MIN) a cada falha fora de sequência (ver
+//   so_adiantamento)
+// com PAGINAS_ADIANTADAS_MAX 0, é só paginação por demanda
+#define PAGINAS_ADIANTADAS 3
+#define PAGINAS_ADIANTADAS_MIN 1
+#define PAGINAS_ADIANTADAS_MAX 16
 #define TERMINAIS 4
 
 // Não tem processos nem memória virtual, mas é preciso usar a paginação,
@@ -56,6 +91,29 @@
 //#define NENHUM_PROCESSO -1
 //#define ALGUM_PROCESSO 0
 
+// imagem de um programa executável na memória secundária
+// é carregada uma vez e usada por todos os processos que executam o programa;
+//   as páginas que um processo não alterou são lidas da imagem, e ficam em
+//   quadros compartilhados por esses processos, sem permissão de escrita
+//   (um processo que altera uma página passa a ter uma cópia só sua)
+typedef struct {
+  char nome[100];     // nome do arquivo executável
+  int *end_sec;       // endereço na memória secundária de cada página
+  int end_carga;
+  int tam;
+  int n_paginas;      // da página 0 até a última do programa
+  // quadro da memória principal que contém cada página da imagem (-1 se
+  //   nenhum); NULL se a entrada da tabela de imagens não foi usada
+  int *quadros;
+  // número de processos vivos executando o programa; a imagem só pode ser
+  //   substituída por outra quando não tiver processos
+  int n_processos;
+} imagem_t;
+
+// número de entradas na tabela de imagens; tendo mais que MAX_PROCESSOS,
+//   sempre tem uma entrada para o programa de um processo novo
+#define MAX_IMAGENS (MAX_PROCESSOS * 2)
+
 struct so_t {
   cpu_t *cpu;
   mem_t *mem;
@@ -79,12 +137,47 @@ struct so_t {
   //     completo que isso  
   mem_t *mem_secundaria;
   FIFO *FIFO;
-  Lista_quadros *lista_quadros_LRU;
-  int algortimo_substituicao;   /*1 = FIFO, 2 = LRU*/
-  int disco_livre;    /*guarda tempo em que o disco estara livre*/
-  int prox_end_pag_livre;
+  LRU *LRU;
+  Relogio_quadros *CLOCK;
+  int algortimo_substituicao;   /*1 = FIFO, 2 = LRU, 3 = CLOCK, 4 = CLOCK com bit de alteração, 5 = WSClock*/
+  int n_quadros;                /*quadros da memória principal (no máximo QUANT_QUADROS)*/
+  int prox_quadro_envelhecer;   /*próximo quadro a visitar no envelhecimento*/
+  // se true, cada processo tem uma quota de quadros controlada pela sua
+  //   frequência de falhas de página, e processos são suspensos quando a
+  //   soma das quotas não cabe na memória
+  bool controle_pff;
+  char *programa_inicial;       /*programa do primeiro processo*/
+  int prox_quadro_local;        /*próximo quadro a visitar na substituição local*/
+  int prox_pedido_disco;  /*identificação do próximo pedido ao disco*/
+  // páginas da memória secundária (de TAM_PAGINA palavras) que estão livres,
+  //   quantas são, e onde começa a busca pela próxima a alocar
+  bool *paginas_sec_livres;
+  int n_paginas_sec;
+  int n_paginas_sec_livres;
+  int prox_pagina_sec;
   bool quadros_livres[QUANT_QUADROS];
+  // tabela de páginas invertida: para cada quadro ocupado, o pid do processo
+  //   dono e a página desse processo que está no quadro (-1 se livre)
   int quadro_processo[QUANT_QUADROS];
+  int quadro_pagina[QUANT_QUADROS];
+  // número de processos que usam cada quadro; mais de um quando o quadro é
+  //   compartilhado com cópia na escrita (ver so_chamada_duplica_proc), e
+  //   então todos têm o quadro na mesma página e quadro_processo é um deles
+  int quadro_refs[QUANT_QUADROS];
+  // imagem da qual o quadro contém uma página sem alteração (-1 se nenhuma)
+  int quadro_imagem[QUANT_QUADROS];
+  // tempo virtual do processo dono no último acesso ao quadro percebido
+  //   pelo SO (para o WSClock)
+  int quadro_ultimo_uso[QUANT_QUADROS];
+  // instruções executadas (D_RELOGIO_INSTRUCOES) quando o processo corrente
+  //   foi despachado, para contar o tempo virtual dele
+  int inicio_execucao;
+  // métricas da paginação dos processos que já terminaram
+  int total_falhas_pagina;
+  int total_paginas_adiantadas;
+  int total_espera_disco;
+  // programas já carregados na memória secundária
+  imagem_t imagens[MAX_IMAGENS];
   // uma tabela de páginas para poder usar a MMU
   // t3: com processos, não tem esta tabela global, tem que ter uma para
   //     cada processo
@@ -123,7 +216,14 @@ so_t *so_cria_valores_processo(so_t *self){
   return self;
 }
 
-so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu, es_t *es, console_t *console, mem_t *mem_sec)
+// nomes dos algoritmos de substituição de páginas, para o log
+static char *nomes_substituicao[] = {
+  [1] = "FIFO", [2] = "LRU", [3] = "CLOCK", [4] = "CLOCK com bit de alteração",
+  [5] = "WSClock",
+};
+
+so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu, es_t *es, console_t *console, mem_t *mem_sec,
+              int algoritmo_substituicao, bool controle_pff, char *programa_inicial)
 {
   so_t *self = malloc(sizeof(*self));
   if (self == NULL) return NULL;
@@ -136,16 +236,45 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu, es_t *es, console_t *console,
   self->erro_interno = false;
 
   self->mem_secundaria = mem_sec;
-  self->algortimo_substituicao = 1;
+  self->n_quadros = mem_tam(mem) / TAM_PAGINA;
+  if(self->n_quadros > QUANT_QUADROS) self->n_quadros = QUANT_QUADROS;
+  if(algoritmo_substituicao < 1 || algoritmo_substituicao > 5) algoritmo_substituicao = 1;
+  self->algortimo_substituicao = algoritmo_substituicao;
   if(self->algortimo_substituicao == 1)
     self->FIFO = fila_cria();
+  else if(self->algortimo_substituicao == 2)
+    self->LRU = lru_cria();
   else
-    self->lista_quadros_LRU = NULL;
-  self->disco_livre = 0;
-  self->prox_end_pag_livre = 0;
+    self->CLOCK = rel_quadros_cria();
+  self->prox_quadro_envelhecer = 0;
+  self->controle_pff = controle_pff;
+  self->programa_inicial = programa_inicial;
+  self->prox_quadro_local = 0;
+  self->prox_pedido_disco = 0;
+  self->n_paginas_sec = mem_tam(mem_sec) / TAM_PAGINA;
+  self->paginas_sec_livres = malloc(self->n_paginas_sec * sizeof(bool));
+  assert(self->paginas_sec_livres != NULL);
+  for(int i = 0; i < self->n_paginas_sec; i++){
+    self->paginas_sec_livres[i] = true;
+  }
+  self->n_paginas_sec_livres = self->n_paginas_sec;
+  self->prox_pagina_sec = 0;
   for(int i = 0; i < QUANT_QUADROS; i++){
-    self->quadros_livres[i] = true;
+    self->quadros_livres[i] = i < self->n_quadros;
     self->quadro_processo[i] = -1;
+    self->quadro_pagina[i] = -1;
+    self->quadro_refs[i] = 0;
+    self->quadro_imagem[i] = -1;
+    self->quadro_ultimo_uso[i] = 0;
+  }
+  self->inicio_execucao = 0;
+  self->total_falhas_pagina = 0;
+  self->total_paginas_adiantadas = 0;
+  self->total_espera_disco = 0;
+  for(int i = 0; i < MAX_IMAGENS; i++){
+    self->imagens[i].end_sec = NULL;
+    self->imagens[i].quadros = NULL;
+    self->imagens[i].n_processos = 0;
   }
 
   self = so_cria_valores_processo(self);
@@ -158,19 +287,44 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu, es_t *es, console_t *console,
   // t3: com processos, essa tabela não existiria, teria uma por processo, que
   //     deve ser colocada na MMU quando o processo é despachado para execução
 
+  console_printf("SO: %d quadros, substituição %s%s", self->n_quadros,
+                 nomes_substituicao[self->algortimo_substituicao],
+                 self->controle_pff ? ", controle da frequência de falhas" : "");
   return self;
 }
 
 void so_destroi(so_t *self)
 {
   cpu_define_chamaC(self->cpu, NULL, NULL);
+  /*processos que ainda não morreram (execução interrompida)*/
+  for(int i = 0; i < MAX_PROCESSOS; i++){
+    processo_t *proc = &self->processos[i];
+    if(proc->estado == morto) continue;
+    tabpag_destroi(proc->tab_pag);
+    free(proc->end_sec_pagina);
+  }
+  lst_libera(self->ini_fila_proc);
+  lst_libera(self->ini_fila_proc_prontos);
+  for(int i = 0; i < MAX_IMAGENS; i++){
+    free(self->imagens[i].end_sec);
+    free(self->imagens[i].quadros);
+  }
+  if(self->algortimo_substituicao == 1)
+    fila_libera(self->FIFO);
+  else if(self->algortimo_substituicao == 2)
+    lru_libera(self->LRU);
+  else
+    rel_quadros_libera(self->CLOCK);
+  free(self->paginas_sec_livres);
   free(self);
 }
 
 static void trata_falha_pagina(so_t* self, int end_erro);
+static void trata_violacao_protecao(so_t* self, int end_erro);
 Lista_processos* so_coloca_fila_pronto(so_t* self, processo_t* processo);
 processo_t* so_proximo_pendente(so_t* self, int quant_bloq);
 static void so_muda_estado_processo(so_t* self, int id_proc, estado_proc est);
+static void so_escalona_medio_prazo(so_t *self);
 
 
 // ---------------------------------------------------------------------
@@ -178,6 +332,7 @@ static void so_muda_estado_processo(so_t* self, int id_proc, estado_proc est);
 // ---------------------------------------------------------------------
 
 // funções auxiliares para o tratamento de interrupção
+static void so_conta_tempo_virtual(so_t *self);
 static void so_salva_estado_da_cpu(so_t *self);
 static void so_trata_irq(so_t *self, int irq);
 static void so_trata_pendencias(so_t *self);
@@ -204,6 +359,8 @@ static int so_trata_interrupcao(void *argC, int reg_A)
   irq_t irq = reg_A;
   // esse print polui bastante, recomendo tirar quando estiver com mais confiança
   console_printf("SO: recebi IRQ %d (%s)", irq, irq_nome(irq));
+  // o processo interrompido executou até agora
+  so_conta_tempo_virtual(self);
   // salva o estado da cpu no descritor do processo que foi interrompido
   so_salva_estado_da_cpu(self);
   // faz o atendimento da interrupção
@@ -213,7 +370,21 @@ static int so_trata_interrupcao(void *argC, int reg_A)
   // escolhe o próximo processo a executar
   so_escalona(self);
   // recupera o estado do processo escolhido
-  return so_despacha(self);
+  int retorno = so_despacha(self);
+  // um erro interno é informado à console, que encerra a execução em lote
+  if (self->erro_interno) console_erro_no_sistema(self->console);
+  return retorno;
+}
+
+// soma ao tempo virtual do processo corrente as instruções que ele executou
+//   desde que foi despachado
+static void so_conta_tempo_virtual(so_t *self)
+{
+  int agora;
+  es_le(self->es, D_RELOGIO_INSTRUCOES, &agora);
+  if(self->processo_corrente != NULL && self->processo_corrente->estado != morto)
+    self->processo_corrente->t_cpu += agora - self->inicio_execucao;
+  self->inicio_execucao = agora;
 }
 
 static void so_salva_estado_da_cpu(so_t *self)
@@ -222,7 +393,8 @@ static void so_salva_estado_da_cpu(so_t *self)
     if (mem_le(self->mem, CPU_END_A, &self->processo_corrente->A) != ERR_OK
         || mem_le(self->mem, CPU_END_PC, &self->processo_corrente->PC) != ERR_OK
         || mem_le(self->mem, CPU_END_erro, &self->processo_corrente->regErro) != ERR_OK
-        || mem_le(self->mem, 59, &self->processo_corrente->X) != ERR_OK) {
+        || mem_le(self->mem, 59, &self->processo_corrente->X) != ERR_OK
+        || mem_le(self->mem, CPU_END_complemento, &self->regComplemento) != ERR_OK) {
       console_printf("SO: erro na leitura dos registradores");
       self->erro_interno = true;
     }
@@ -269,17 +441,8 @@ static void so_trata_pendencias(so_t *self)
       }
     }
   }
-  //desbloqueio de acesso a disco para processos
-  int agora;
-  es_le(self->es, D_RELOGIO_REAL, &agora);
-  if(agora >= self->disco_livre){
-    for(int i = 0; i < MAX_PROCESSOS; i++){
-      if(self->processos[i].estado == bloqueado && self->processos[i].espera == 3){ /*espera por disco livre*/
-        self->processos[i].espera = 0;
-        so_muda_estado_processo(self, i, pronto);
-      }
-    }
-  }
+  /*processos suspensos ou a suspender por falta de memória*/
+  so_escalona_medio_prazo(self);
 
   /*bloqueia processos por tempo de cpu e reinicia o quantum*/
   if(self->escalonador != simples){
@@ -351,6 +514,7 @@ static void so_trata_reset(so_t *self);
 static void so_trata_irq_chamada_sistema(so_t *self);
 static void so_trata_irq_err_cpu(so_t *self);
 static void so_trata_irq_relogio(so_t *self);
+static void so_trata_irq_disco(so_t *self);
 static void so_trata_irq_desconhecida(so_t *self, int irq);
 
 static void so_trata_irq(so_t *self, int irq)
@@ -369,6 +533,9 @@ static void so_trata_irq(so_t *self, int irq)
     case IRQ_RELOGIO:
       so_trata_irq_relogio(self);
       break;
+    case IRQ_DISCO:
+      so_trata_irq_disco(self);
+      break;
     default:
       so_trata_irq_desconhecida(self, irq);
   }
@@ -376,7 +543,16 @@ static void so_trata_irq(so_t *self, int irq)
 
 processo_t* so_cria_entrada_processo(so_t* self, int PC, int tam);
 static int so_proximo_quadro_livre(so_t *self);
+static void so_solta_quadro(so_t *self, int quadro, int id_proc);
+static bool so_cabe_na_secundaria(so_t *self, int n);
+static int so_aloca_pagina_secundaria(so_t *self);
+static void so_libera_pagina_secundaria(so_t *self, int end);
 static void so_chamada_mata_proc(so_t *self);
+static void so_envelhece_quadros(so_t *self);
+static void so_pff_avalia(so_t *self, processo_t *proc);
+static void so_pff_verifica_demanda(so_t *self, processo_t *proc);
+static bool so_pff_memoria_sobrando(so_t *self);
+static void so_suspende_processo(so_t *self, processo_t *proc);
 
 // chamada uma única vez, quando a CPU inicializa
 static void so_trata_reset(so_t *self)
@@ -405,14 +581,13 @@ static void so_trata_reset(so_t *self)
   //   contém o endereço final da memória protegida (que não podem ser usadas
   //   por programas de usuário)
   // t3: o controle de memória livre deve ser mais aprimorado que isso    
-  self->prox_end_pag_livre = (CPU_END_FIM_PROT / TAM_PAGINA + 1) * TAM_PAGINA;
   for(int i = 0; i < CPU_END_FIM_PROT/TAM_PAGINA +1; i++){
     self->quadros_livres[i] = false;
   }
 
   // coloca o programa init na memória
   processo_t *init =  so_cria_entrada_processo(self, 0, 0); // deveria inicializar um processo...
-  ender = so_carrega_programa(self, init, "init.maq");
+  ender = so_carrega_programa(self, init, self->programa_inicial);
   if (ender == -1) {
     console_printf("SO: problema na carga do programa inicial");
     self->erro_interno = true;
@@ -438,8 +613,13 @@ static void so_trata_irq_err_cpu(so_t *self)
   mem_le(self->mem, CPU_END_erro, &self->processo_corrente->regErro);
   err_t err = self->processo_corrente->regErro;
   if(err == ERR_PAG_AUSENTE){
+    self->processo_corrente->regErro = ERR_OK;
     trata_falha_pagina(self, self->regComplemento);
   }
+  else if(err == ERR_PAG_PROTEGIDA){
+    self->processo_corrente->regErro = ERR_OK;
+    trata_violacao_protecao(self, self->regComplemento);
+  }
   else if(err != ERR_OK && err != ERR_OCUP){
     console_printf("SO: Erro na CPU: %s, matando processo", err_nome(err));
     so_chamada_mata_proc(self);
@@ -463,8 +643,38 @@ static void so_trata_irq_relogio(so_t *self)
   if(self->escalonador != simples && self->processo_corrente != NULL)
     self->processo_corrente->quantum--; 
 
-  if(self->processo_corrente != NULL && self->algortimo_substituicao == 2){
-    atualiza_envelhecimento(self->lista_quadros_LRU, self->processo_corrente->tab_pag, self->quadro_processo, self->processo_corrente->id);
+  if(self->algortimo_substituicao == 2 || self->algortimo_substituicao == 5)
+    so_envelhece_quadros(self);
+  if(self->controle_pff && self->processo_corrente != NULL)
+    so_pff_avalia(self, self->processo_corrente);
+}
+
+// interrupção gerada quando o disco conclui transferências
+// cada pedido concluído desbloqueia o processo que espera por ele (pedidos
+//   sem ninguém esperando, como as cópias de um processo suspenso, são só
+//   descartados); a interrupção é desligada quando não tem mais concluídos
+static void so_trata_irq_disco(so_t *self)
+{
+  int agora;
+  es_le(self->es, D_RELOGIO_INSTRUCOES, &agora);
+  for(;;){
+    int pedido;
+    if (es_le(self->es, D_DISCO_CONCLUIDO, &pedido) != ERR_OK) {
+      console_printf("SO: problema no acesso ao disco");
+      self->erro_interno = true;
+      return;
+    }
+    if(pedido == -1) break;
+    for(int i = 0; i < MAX_PROCESSOS; i++){
+      processo_t *proc = &self->processos[i];
+      if(proc->estado == bloqueado && proc->espera == 3 && proc->pedido_disco == pedido){
+        proc->espera = 0;
+        proc->pedido_disco = -1;
+        proc->t_espera_disco += agora - proc->inicio_espera_disco;
+        so_muda_estado_processo(self, proc->id, pronto);
+        break;
+      }
+    }
   }
 }
 
@@ -484,6 +694,7 @@ static void so_trata_irq_desconhecida(so_t *self, int irq)
 static void so_chamada_le(so_t *self);
 static void so_chamada_escr(so_t *self);
 static void so_chamada_cria_proc(so_t *self);
+static void so_chamada_duplica_proc(so_t *self);
 static void so_chamada_mata_proc(so_t *self);
 static void so_chamada_espera_proc(so_t *self);
 
@@ -501,6 +712,9 @@ static void so_trata_irq_chamada_sistema(so_t *self)
     case SO_CRIA_PROC:
       so_chamada_cria_proc(self);
       break;
+    case SO_DUPLICA_PROC:
+      so_chamada_duplica_proc(self);
+      break;
     case SO_MATA_PROC:
       so_chamada_mata_proc(self);
       break;
@@ -572,10 +786,16 @@ static void so_chamada_cria_proc(so_t *self)
   // t3: identifica direito esses processos
   processo_t *processo_criador = self->processo_corrente;
   processo_t *processo_criado = so_cria_entrada_processo(self, 0, 0); /*inicializa com valores "incorretos" para PC e tam*/
+  if(processo_criado == NULL){
+    processo_criador->A = -1;
+    altera_registrador_A(self, processo_criador);
+    return;
+  }
 
   int ender_proc, ender_carga;
   ender_proc = self->processo_corrente->X;
   char nome[100];
+  bool criado = false;
   if (so_copia_str_do_processo(self, 100, nome, ender_proc, processo_criador)) {
     ender_carga = so_carrega_programa(self, processo_criado, nome);
     if (ender_carga != -1) {
@@ -583,12 +803,16 @@ static void so_chamada_cria_proc(so_t *self)
       processo_criado->regErro = 0;
       self->ini_fila_proc_prontos = so_coloca_fila_pronto(self, processo_criado);
       self->ini_fila_proc = lst_insere_ordenado(self->ini_fila_proc, processo_criado->id, processo_criado->prio);
-    } else{
-      processo_criado->erro = ERR_OP_INV;
-      processo_criado->regErro = 1;
+      if(self->controle_pff)
+        so_pff_verifica_demanda(self, processo_criador);
+      criado = true;
     }
   }
-  if(processo_criado->regErro == 1){
+  if(!criado){
+    /*a entrada do processo que não foi criado volta a ficar livre; se ficasse
+      pronta fora das filas, o sistema nunca ficaria sem processos vivos*/
+    tabpag_destroi(processo_criado->tab_pag);
+    processo_criado->estado = morto;
     processo_criador->A = -1;
   } else{
     processo_criador->A = processo_criado->id;
@@ -597,7 +821,87 @@ static void so_chamada_cria_proc(so_t *self)
 
 }
 
+// implementação da chamada se sistema SO_DUPLICA_PROC
+// cria um processo que é uma cópia do processo corrente
+// a memória não é copiada: os quadros em memória principal passam a ser
+//   compartilhados pelos dois processos, sem permissão de escrita; o primeiro
+//   que escrever em uma página recebe uma cópia dela (ver
+//   trata_violacao_protecao). Só as páginas alteradas que estão na memória
+//   secundária são copiadas, para que cada processo salve e recupere as suas.
+static void so_chamada_duplica_proc(so_t *self)
+{
+  processo_t *pai = self->processo_corrente;
+  imagem_t *imagem = &self->imagens[pai->imagem];
+  int n_salvas = 0;
+  for(int p = 0; p < imagem->n_paginas; p++){
+    if(pai->end_sec_pagina[p] != -1) n_salvas++;
+  }
+  if(!so_cabe_na_secundaria(self, n_salvas)){
+    console_printf("SO: memória secundária cheia");
+    pai->A = -1;
+    return;
+  }
+  processo_t *filho = so_cria_entrada_processo(self, pai->memIni, pai->memTam);
+  if(filho == NULL){
+    pai->A = -1;
+    return;
+  }
+  filho->PC = pai->PC;
+  filho->quota_quadros = pai->quota_quadros;
+  filho->X = pai->X;
+  filho->A = 0;   /*o filho recebe 0, o pai o pid do filho*/
+  /*o filho executa o mesmo programa*/
+  filho->imagem = pai->imagem;
+  imagem->n_processos++;
+  filho->end_sec_pagina = malloc(imagem->n_paginas * sizeof(int));
+  assert(filho->end_sec_pagina != NULL);
+
+  int pagina_ini = pai->memIni / TAM_PAGINA;
+  int pagina_fim = pagina_ini + pai->n_paginas;
+  tabpag_reserva(filho->tab_pag, pagina_fim);
+
+  /*as páginas que o pai alterou e salvou na memória secundária são copiadas
+    para o filho*/
+  for(int p = 0; p < imagem->n_paginas; p++){
+    filho->end_sec_pagina[p] = -1;
+    if(pai->end_sec_pagina[p] == -1) continue;
+    filho->end_sec_pagina[p] = so_aloca_pagina_secundaria(self);
+    for(int i = 0; i < TAM_PAGINA; i++){
+      int valor;
+      mem_le(self->mem_secundaria, pai->end_sec_pagina[p] + i, &valor);
+      mem_escreve(self->mem_secundaria, filho->end_sec_pagina[p] + i, valor);
+    }
+  }
+
+  /*compartilha os quadros das páginas presentes*/
+  int n_compartilhadas = 0;
+  for(int p = pagina_ini; p < pagina_fim; p++){
+    int quadro;
+    if(tabpag_traduz(pai->tab_pag, p, &quadro) != ERR_OK) continue;
+    tabpag_define_quadro(filho->tab_pag, p, quadro);
+    /*se o pai alterou a página, a cópia no disco do filho também está desatualizada*/
+    if(tabpag_bit_alteracao(pai->tab_pag, p))
+      tabpag_marca_bit_acesso(filho->tab_pag, p, true);
+    tabpag_define_protecao(pai->tab_pag, p, TABPAG_EXECUCAO);
+    tabpag_define_protecao(filho->tab_pag, p, TABPAG_EXECUCAO);
+    self->quadro_refs[quadro]++;
+    filho->n_quadros++;
+    n_compartilhadas++;
+  }
+  console_printf("SO: processo %d duplicado no processo %d, %d páginas compartilhadas",
+                 pai->id, filho->id, n_compartilhadas);
+
+  filho->erro = ERR_OK;
+  filho->regErro = 0;
+  self->ini_fila_proc_prontos = so_coloca_fila_pronto(self, filho);
+  self->ini_fila_proc = lst_insere_ordenado(self->ini_fila_proc, filho->id, filho->prio);
+  pai->A = filho->id;
+  if(self->controle_pff)
+    so_pff_verifica_demanda(self, pai);
+}
+
 static void so_libera_espera_proc(so_t *self, int id_proc_morrendo);
+bool so_tem_processo_vivo(so_t* self);
 
 // implementação da chamada se sistema SO_MATA_PROC
 // mata o processo com pid X (ou o processo corrente se X é 0)
@@ -613,13 +917,31 @@ static void so_chamada_mata_proc(so_t *self)
     self->processo_corrente->A = -1;
   }
 
-  for(int i = 0; i < QUANT_QUADROS; i++){
-    if(self->quadro_processo[i] == id_proc_a_matar){
-      self->quadro_processo[i] = -1;
-      self->quadros_livres[i] = true;
-    }
+  processo_t *proc = self->processo_corrente;
+  console_printf("SO: processo %d com %d falhas de página, %d páginas adiantadas, %d instruções esperando o disco",
+                 proc->id, proc->n_falha_paginas, proc->n_paginas_adiantadas, proc->t_espera_disco);
+  self->total_falhas_pagina += proc->n_falha_paginas;
+  self->total_paginas_adiantadas += proc->n_paginas_adiantadas;
+  self->total_espera_disco += proc->t_espera_disco;
+
+  /*libera os quadros do processo (os compartilhados continuam com os outros)*/
+  tabpag_t *tab = self->processo_corrente->tab_pag;
+  for(int p = 0; p < tabpag_numero_pagina(tab); p++){
+    int quadro;
+    if(tabpag_traduz(tab, p, &quadro) == ERR_OK)
+      so_solta_quadro(self, quadro, id_proc_a_matar);
   }
   tabpag_destroi(self->processo_corrente->tab_pag);
+  if(self->processo_corrente->imagem != -1){
+    imagem_t *imagem = &self->imagens[self->processo_corrente->imagem];
+    /*devolve as cópias das páginas que o processo salvou na memória secundária*/
+    for(int p = 0; p < imagem->n_paginas; p++)
+      so_libera_pagina_secundaria(self, self->processo_corrente->end_sec_pagina[p]);
+    imagem->n_processos--;
+    self->processo_corrente->imagem = -1;
+  }
+  free(self->processo_corrente->end_sec_pagina);
+  self->processo_corrente->end_sec_pagina = NULL;
 
   so_muda_estado_processo(self, id_proc_a_matar, morto);
 
@@ -630,6 +952,16 @@ static void so_chamada_mata_proc(so_t *self)
 
   so_libera_espera_proc(self, id_proc_a_matar);
 
+  /*sem processos vivos, o sistema nao tem mais o que fazer*/
+  if(!so_tem_processo_vivo(self)){
+    long acertos, faltas;
+    mmu_estatisticas_tlb(self->mmu, &acertos, &faltas);
+    console_printf("SO: TLB com %ld acertos e %ld faltas", acertos, faltas);
+    console_printf("SO: paginação com %d falhas, %d páginas adiantadas, %d instruções esperando o disco",
+                   self->total_falhas_pagina, self->total_paginas_adiantadas, self->total_espera_disco);
+    console_sistema_terminou(self->console);
+  }
+
   self->regA = 0; //tudo ok
 }
 
@@ -637,6 +969,12 @@ static void so_chamada_mata_proc(so_t *self)
 // espera o fim do processo com pid X
 static void so_chamada_espera_proc(so_t *self)
 {
+  /*nao bloqueia esperando processo que nao existe (ou ja morreu)*/
+  int indice = encontra_indice_processo(self->processos, self->processo_corrente->X);
+  if(indice == -1 || self->processos[indice].estado == morto){
+    self->processo_corrente->A = -1;
+    return;
+  }
   so_muda_estado_processo(self, self->processo_corrente->id, bloqueado);
   if(lst_busca(self->ini_fila_proc_prontos, self->processo_corrente->id) != NULL){
     self->ini_fila_proc_prontos = lst_retira(self->ini_fila_proc_prontos, self->processo_corrente->id);
@@ -650,7 +988,9 @@ static void so_chamada_espera_proc(so_t *self)
 
 // funções auxiliares
 static int so_carrega_programa_na_memoria_fisica(so_t *self, programa_t *programa);
-static int so_carrega_programa_na_memoria_virtual(so_t *self, programa_t *programa, processo_t *processo);
+static int so_carrega_programa_na_memoria_virtual(so_t *self, programa_t *programa, imagem_t *imagem);
+static int so_busca_imagem(so_t *self, char *nome_do_executavel);
+static void so_descarta_imagem(so_t *self, imagem_t *imagem);
 
 // carrega o programa na memória
 // se processo for NENHUM_PROCESSO, carrega o programa na memória física
@@ -660,26 +1000,40 @@ static int so_carrega_programa(so_t *self, processo_t *processo, char *nome_do_e
 {
   console_printf("SO: carga de '%s'", nome_do_executavel);
 
+  if (processo != NULL) {
+    // o programa é carregado na memória secundária uma vez só, na imagem,
+    //   que é usada por todos os processos que executam esse programa
+    int ind_imagem = so_busca_imagem(self, nome_do_executavel);
+    if (ind_imagem == -1) {
+      console_printf("Erro ao carregar programa, endereco -1");
+      return -1;
+    }
+    imagem_t *imagem = &self->imagens[ind_imagem];
+    imagem->n_processos++;
+    processo->imagem = ind_imagem;
+    /*coloca os valores corretos do processo*/
+    processo->PC = imagem->end_carga;
+    processo->memIni = processo->PC;
+    processo->memTam = imagem->tam;
+    processo->n_paginas = (processo->memTam + TAM_PAGINA - 1) / TAM_PAGINA;
+    /*o processo só ocupa memória secundária com as páginas que alterar*/
+    processo->end_sec_pagina = malloc(imagem->n_paginas * sizeof(int));
+    assert(processo->end_sec_pagina != NULL);
+    for (int p = 0; p < imagem->n_paginas; p++) {
+      processo->end_sec_pagina[p] = -1;
+    }
+    /*as paginas serao definidas uma a uma nas falhas de pagina*/
+    tabpag_reserva(processo->tab_pag, processo->memIni / TAM_PAGINA + processo->n_paginas);
+    return imagem->end_carga;
+  }
+
   programa_t *programa = prog_cria(nome_do_executavel);
   if (programa == NULL) {
     console_printf("Erro na leitura do programa '%s'\n", nome_do_executavel);
     return -1;
   }
 
-  int end_carga;
-  if (processo == NULL) {
-    end_carga = so_carrega_programa_na_memoria_fisica(self, programa);
-  } else {
-    int end_disco = self->prox_end_pag_livre;
-    end_carga = so_carrega_programa_na_memoria_virtual(self, programa, processo);
-    if(end_carga != -1)
-      processo->pos_ini_mem_sec = end_disco;
-    /*coloca os valores corretos do processo*/
-    processo->PC = prog_end_carga(programa);
-    processo->memIni = processo->PC;
-    processo->memTam = prog_tamanho(programa);
-  }  
-
+  int end_carga = so_carrega_programa_na_memoria_fisica(self, programa);
   if(end_carga == -1){
     console_printf("Erro ao carregar programa, endereco -1");
   }
@@ -688,6 +1042,65 @@ static int so_carrega_programa(so_t *self, processo_t *processo, char *nome_do_e
   return end_carga;
 }
 
+// retorna o índice da imagem do executável na tabela de imagens,
+//   carregando o programa na memória secundária se ainda não tiver
+// uma imagem que não é usada por nenhum processo pode ser substituída
+// retorna -1 em caso de erro
+static int so_busca_imagem(so_t *self, char *nome_do_executavel)
+{
+  int livre = -1;
+  for (int i = 0; i < MAX_IMAGENS; i++) {
+    imagem_t *imagem = &self->imagens[i];
+    if (imagem->quadros != NULL && strcmp(imagem->nome, nome_do_executavel) == 0) {
+      console_printf("SO: '%s' já está na memória secundária", nome_do_executavel);
+      return i;
+    }
+    if (imagem->n_processos == 0 && (livre == -1 || imagem->quadros == NULL)) {
+      livre = i;
+    }
+  }
+  if (livre == -1) {
+    console_printf("SO: tabela de imagens cheia");
+    return -1;
+  }
+  if (strlen(nome_do_executavel) >= sizeof(self->imagens[livre].nome)) return -1;
+
+  programa_t *programa = prog_cria(nome_do_executavel);
+  if (programa == NULL) {
+    console_printf("Erro na leitura do programa '%s'\n", nome_do_executavel);
+    return -1;
+  }
+  imagem_t *imagem = &self->imagens[livre];
+  so_descarta_imagem(self, imagem);
+  // se o programa não couber na memória secundária, descarta as imagens que
+  //   não estão sendo usadas
+  int n_paginas = (prog_end_carga(programa) + prog_tamanho(programa) - 1) / TAM_PAGINA + 1;
+  for (int i = 0; i < MAX_IMAGENS && !so_cabe_na_secundaria(self, n_paginas); i++) {
+    if (self->imagens[i].n_processos == 0) so_descarta_imagem(self, &self->imagens[i]);
+  }
+  if (so_carrega_programa_na_memoria_virtual(self, programa, imagem) == -1) {
+    prog_destroi(programa);
+    return -1;
+  }
+  strcpy(imagem->nome, nome_do_executavel);
+  prog_destroi(programa);
+  return livre;
+}
+
+// descarta uma imagem que não tem processos (e por isso nem quadros na
+//   memória principal), devolvendo as suas páginas na memória secundária
+static void so_descarta_imagem(so_t *self, imagem_t *imagem)
+{
+  if (imagem->quadros == NULL) return;
+  for (int p = 0; p < imagem->n_paginas; p++) {
+    so_libera_pagina_secundaria(self, imagem->end_sec[p]);
+  }
+  free(imagem->end_sec);
+  imagem->end_sec = NULL;
+  free(imagem->quadros);
+  imagem->quadros = NULL;
+}
+
 static int so_carrega_programa_na_memoria_fisica(so_t *self, programa_t *programa)
 {
   int end_ini = prog_end_carga(programa);
@@ -703,17 +1116,11 @@ static int so_carrega_programa_na_memoria_fisica(so_t *self, programa_t *program
   return end_ini;
 }
 
-static int so_carrega_programa_na_memoria_virtual(so_t *self, programa_t *programa, processo_t *processo)
+// carrega o programa na memória secundária, na imagem
+// as páginas dos processos que executam o programa são colocadas na memória
+//   principal por demanda, a partir da imagem
+static int so_carrega_programa_na_memoria_virtual(so_t *self, programa_t *programa, imagem_t *imagem)
 {
-  // t3: isto tá furado...
-  // está simplesmente lendo para o próximo quadro que nunca foi ocupado,
-  //   nem testa se tem memória disponível
-  // com memória virtual, a forma mais simples de implementar a carga de um
-  //   programa é carregá-lo para a memória secundária, e mapear todas as páginas
-  //   da tabela de páginas do processo como inválidas. Assim, as páginas serão
-  //   colocadas na memória principal por demanda. Para simplificar ainda mais, a
-  //   memória secundária pode ser alocada da forma como a principal está sendo
-  //   alocada aqui (sem reuso)
   int end_virt_ini = prog_end_carga(programa);
   // o código abaixo só funciona se o programa iniciar no início de uma página
   if ((end_virt_ini % TAM_PAGINA) != 0) return -1;
@@ -721,18 +1128,31 @@ static int so_carrega_programa_na_memoria_virtual(so_t *self, programa_t *progra
   int pagina_ini = end_virt_ini / TAM_PAGINA;
   int pagina_fim = end_virt_fim / TAM_PAGINA;
   int n_paginas = pagina_fim - pagina_ini + 1;
-  int end_sec = self->prox_end_pag_livre;
+  // as páginas da imagem não precisam ser contíguas na memória secundária
+  if (!so_cabe_na_secundaria(self, pagina_fim + 1)) {
+    console_printf("SO: memória secundária cheia");
+    return -1;
+  }
+  imagem->end_sec = malloc((pagina_fim + 1) * sizeof(int));
+  assert(imagem->end_sec != NULL);
+  for (int p = 0; p <= pagina_fim; p++) {
+    imagem->end_sec[p] = so_aloca_pagina_secundaria(self);
+  }
 
   for (int i = end_virt_ini; i <= end_virt_fim; i++) {
-    mem_escreve(self->mem_secundaria, end_sec + i, prog_dado(programa, i));
-  }
-  for(int p = pagina_ini; p <= pagina_fim; p++){
-    tabpag_invalida_pagina(processo->tab_pag, p);
+    int end_sec = imagem->end_sec[i / TAM_PAGINA] + i % TAM_PAGINA;
+    mem_escreve(self->mem_secundaria, end_sec, prog_dado(programa, i));
   }
 
-  self->prox_end_pag_livre += n_paginas * TAM_PAGINA;
+  imagem->end_carga = end_virt_ini;
+  imagem->tam = prog_tamanho(programa);
+  imagem->n_paginas = pagina_fim + 1;
+  imagem->quadros = malloc(imagem->n_paginas * sizeof(int));
+  assert(imagem->quadros != NULL);
+  for (int p = 0; p < imagem->n_paginas; p++) {
+    imagem->quadros[p] = -1;
+  }
 
-  //console_printf("SO: carga na memória virtual V%d-%d F%d-%d npag=%d", end_virt_ini, end_virt_fim, end_fis_ini, end_fis - 1, n_paginas);
   console_printf("SO: carga na memória virtual V%d-%d npag=%d", end_virt_ini, end_virt_fim, n_paginas);
   return end_virt_ini;
 }
@@ -742,6 +1162,8 @@ static int so_carrega_programa_na_memoria_virtual(so_t *self, programa_t *progra
 // ACESSO À MEMÓRIA DOS PROCESSOS {{{1
 // ---------------------------------------------------------------------
 
+static int so_end_secundario(so_t *self, processo_t *proc, int pagina);
+
 // copia uma string da memória do processo para o vetor str.
 // retorna false se erro (string maior que vetor, valor não char na memória,
 //   erro de acesso à memória)
@@ -758,9 +1180,10 @@ static bool so_copia_str_do_processo(so_t *self, int tam, char str[tam],
     //   os endereços e acessar a memória, porque todo o conteúdo do processo
     //   está na memória principal, e só temos uma tabela de páginas
     if (mmu_le(self->mmu, end_virt + indice_str, &caractere, usuario) != ERR_OK) {
-      int end_sec = end_virt + processo->pos_ini_mem_sec;
-      if(end_sec > processo->pos_ini_mem_sec + processo->n_paginas * TAM_PAGINA)
+      int end = end_virt + indice_str;
+      if(end < 0 || end >= processo->n_paginas * TAM_PAGINA)
         return false;
+      int end_sec = so_end_secundario(self, processo, end / TAM_PAGINA) + end % TAM_PAGINA;
       mem_le(self->mem_secundaria, end_sec, &caractere);
     }
     if (caractere < 0 || caractere > 255) {
@@ -805,6 +1228,15 @@ Lista_processos* so_coloca_fila_pronto(so_t* self, processo_t* processo){
   return self->ini_fila_proc_prontos;
 }
 
+bool so_tem_processo_vivo(so_t* self){
+  for(int i = 0; i < MAX_PROCESSOS; i++){
+    if(self->processos[i].estado != morto){
+      return true;
+    }
+  }
+  return false;
+}
+
 int so_busca_entrada_tabela(so_t* self){
   for(int i = 0; i < MAX_PROCESSOS; i++){
     if(self->processos[i].estado == morto){
@@ -821,7 +1253,10 @@ processo_t* so_cria_entrada_processo(so_t* self, int PC, int tam) {
         return NULL;
     }
     int id = self->cont_processos++;
-    inicializa_processo(&self->processos[i], id, PC, tam);
+    inicializa_processo(&self->processos[i], id, PC, tam, i);
+    self->processos[i].quota_quadros = PFF_QUOTA_INICIAL;
+    for(int s = 0; s < SEQUENCIAS_POR_PROCESSO; s++)
+      self->processos[i].seq_n_adiantar[s] = PAGINAS_ADIANTADAS;
     self->processos[i].estado = pronto;
     return &self->processos[i];
 }
@@ -857,7 +1292,9 @@ static void so_muda_estado_processo(so_t* self, int id_proc, estado_proc est){
   self->ini_fila_proc = lst_altera_estado(self->ini_fila_proc, id_proc, est);
 
   if(est == pronto){
-    self->ini_fila_proc_prontos = so_coloca_fila_pronto(self, self->processo_corrente);
+    int indice = encontra_indice_processo(self->processos, id_proc);
+    if(indice != -1)
+      self->ini_fila_proc_prontos = so_coloca_fila_pronto(self, &self->processos[indice]);
   }
   else{ /*bloqueado ou morto*/
     self->ini_fila_proc_prontos = lst_retira(self->ini_fila_proc_prontos, id_proc); 
@@ -869,7 +1306,8 @@ static void so_muda_estado_processo(so_t* self, int id_proc, estado_proc est){
 
 static void so_libera_espera_proc(so_t *self, int id_proc_morrendo){
   for(int i = 0; i < MAX_PROCESSOS; i++){ 
-    if(self->processos[i].X == id_proc_morrendo){
+    if(self->processos[i].estado == bloqueado && self->processos[i].espera == 0
+       && self->processos[i].X == id_proc_morrendo){
       so_muda_estado_processo(self, self->processos[i].id, pronto);
     }
   }
@@ -879,18 +1317,22 @@ static void so_libera_espera_proc(so_t *self, int id_proc_morrendo){
 // FALHA DE PÁGINA
 // ---------------------------------------------------------------------
 
-static void atualiza_tempo_acesso_disco(so_t *self){
-  int agora;
-  es_le(self->es, D_RELOGIO_REAL, &agora);
-  if (agora < self->disco_livre) {
-      self->disco_livre += ESPERA_ACESSO_SECUNDARIA;
-  } else {
-      self->disco_livre = agora + ESPERA_ACESSO_SECUNDARIA;
+// pede ao disco uma transferência de 'n_paginas' páginas, que é atendida
+//   depois das que já estão na fila; quando terminar, o disco interrompe
+// retorna a identificação do pedido, ou -1 se o disco não aceitou
+static int so_pede_disco(so_t *self, int n_paginas){
+  int pedido = self->prox_pedido_disco;
+  if (es_escreve(self->es, D_DISCO_TAMANHO, n_paginas) != ERR_OK
+      || es_escreve(self->es, D_DISCO_PEDIDO, pedido) != ERR_OK) {
+    console_printf("SO: problema no pedido ao disco");
+    return -1;
   }
+  self->prox_pedido_disco = (pedido + 1) & 0x7fffffff;
+  return pedido;
 }
 
 static int so_proximo_quadro_livre(so_t *self){
-  for(int i = 0; i < QUANT_QUADROS; i++){
+  for(int i = 0; i < self->n_quadros; i++){
     if(self->quadros_livres[i]){
       return i;
     }
@@ -898,60 +1340,380 @@ static int so_proximo_quadro_livre(so_t *self){
   return -1;
 }
 
+// retorna true se o processo está vivo e tem a página 'pagina' no quadro 'quadro'
+static bool so_processo_usa_quadro(processo_t *proc, int pagina, int quadro){
+  int quadro_da_pagina;
+  return proc->estado != morto
+      && tabpag_traduz(proc->tab_pag, pagina, &quadro_da_pagina) == ERR_OK
+      && quadro_da_pagina == quadro;
+}
+
+// o quadro deixa de ser usado como a página da imagem do programa (porque foi
+//   liberado ou vai ser alterado)
+static void so_esquece_imagem(so_t *self, int quadro){
+  int ind_imagem = self->quadro_imagem[quadro];
+  if(ind_imagem == -1) return;
+  self->imagens[ind_imagem].quadros[self->quadro_pagina[quadro]] = -1;
+  self->quadro_imagem[quadro] = -1;
+}
+
+// retorna o endereço da página 'pagina' do processo na memória secundária:
+//   o da cópia do processo, se ele alterou e salvou a página, ou o da imagem
+//   do programa
+static int so_end_secundario(so_t *self, processo_t *proc, int pagina){
+  if(proc->end_sec_pagina[pagina] != -1)
+    return proc->end_sec_pagina[pagina];
+  return self->imagens[proc->imagem].end_sec[pagina];
+}
+
+// retorna true se ainda cabem 'n' páginas na memória secundária
+static bool so_cabe_na_secundaria(so_t *self, int n){
+  return n <= self->n_paginas_sec_livres;
+}
+
+// aloca espaço para uma página na memória secundária, procurando uma página
+//   livre a partir da última alocada
+// retorna o endereço da página, ou -1 se não tiver mais espaço
+static int so_aloca_pagina_secundaria(so_t *self){
+  if(!so_cabe_na_secundaria(self, 1)){
+    console_printf("SO: memória secundária cheia");
+    return -1;
+  }
+  while(!self->paginas_sec_livres[self->prox_pagina_sec])
+    self->prox_pagina_sec = (self->prox_pagina_sec + 1) % self->n_paginas_sec;
+  self->paginas_sec_livres[self->prox_pagina_sec] = false;
+  self->n_paginas_sec_livres--;
+  return self->prox_pagina_sec * TAM_PAGINA;
+}
+
+// devolve a página da memória secundária que está no endereço 'end'
+//   (-1 é uma página que não foi alocada)
+static void so_libera_pagina_secundaria(so_t *self, int end){
+  if(end == -1) return;
+  int pagina = end / TAM_PAGINA;
+  assert(!self->paginas_sec_livres[pagina]);
+  self->paginas_sec_livres[pagina] = true;
+  self->n_paginas_sec_livres++;
+}
+
+// tira o quadro liberado do algoritmo de substituição (a vítima escolhida
+//   pelo algoritmo já saiu); quando for ocupado de novo, entra como um quadro
+//   novo, sem o histórico de acessos da página anterior
+static void so_tira_da_substituicao(so_t *self, int quadro){
+  if(self->algortimo_substituicao == 1)
+    fila_remove(self->FIFO, quadro);
+  else if(self->algortimo_substituicao == 2)
+    lru_remove(self->LRU, quadro);
+  else
+    rel_quadros_retira(self->CLOCK, quadro);
+}
+
+// copia a página do processo que está no quadro para a sua cópia na memória
+//   secundária, alocando espaço para ela na primeira vez
+// retorna false se não tiver espaço na memória secundária
+static bool so_salva_copia_do_processo(so_t *self, processo_t *proc, int pagina, int quadro){
+  if(proc->end_sec_pagina[pagina] == -1){
+    proc->end_sec_pagina[pagina] = so_aloca_pagina_secundaria(self);
+    if(proc->end_sec_pagina[pagina] == -1) return false;
+  }
+  int end_secundario = proc->end_sec_pagina[pagina];   //endereço físico do disco
+  for (int i = 0; i < TAM_PAGINA; i++) {
+    int valor;
+    mem_le(self->mem, quadro * TAM_PAGINA + i, &valor);
+    mem_escreve(self->mem_secundaria, end_secundario + i, valor);
+  }
+  tabpag_zera_bit_alterada(proc->tab_pag, pagina);
+  return true;
+}
+
+// libera o quadro, copiando a página para a memória secundária se algum
+//   processo que usa o quadro a alterou
+// retorna o número de cópias feitas para a memória secundária, ou -1 em erro
 static int so_troca_salva_pagina(so_t *self, int quadro_fisico){
   if (self->quadros_livres[quadro_fisico]) {
-    return 1; //quadro livre, sem dados
+    return 0; //quadro livre, sem dados
   }
   int ind = encontra_indice_processo(self->processos, self->quadro_processo[quadro_fisico]);  //encontra indice do processo a ser substituido
   if(ind == -1){
     console_printf("SO: Erro critico - quadro %d marcado ocupado por processo inexistente", quadro_fisico);
+    so_esquece_imagem(self, quadro_fisico);
     self->quadros_livres[quadro_fisico] = true;
     self->quadro_processo[quadro_fisico] = -1;
-    return 1;
+    self->quadro_pagina[quadro_fisico] = -1;
+    self->quadro_refs[quadro_fisico] = 0;
+    return 0;
   }
   processo_t *proc_substituido = &self->processos[ind];
-  int pagina = tabpag_encontra_pagina_pelo_quadro(proc_substituido->tab_pag, quadro_fisico);
-  if (pagina == -1) {
+  /*a pagina que esta no quadro vem da tabela invertida; confere com a tabela do processo*/
+  int pagina = self->quadro_pagina[quadro_fisico];
+  int quadro_da_pagina;
+  if (tabpag_traduz(proc_substituido->tab_pag, pagina, &quadro_da_pagina) != ERR_OK
+      || quadro_da_pagina != quadro_fisico) {
       console_printf("SO: quadro %d não pertence ao processo corrente.\n", quadro_fisico);
       return -1;
   }
-  if(tabpag_bit_alteracao(proc_substituido->tab_pag, pagina)){   //pagina foi alterada
-    int end_secundario = proc_substituido->pos_ini_mem_sec + (pagina * TAM_PAGINA);   //endereço físico do disco
-    /*copia dados da RAM para disco*/
-    for (int i = 0; i < TAM_PAGINA; i++) {
-      int valor;
-      mem_le(self->mem, quadro_fisico * TAM_PAGINA + i, &valor);
-      mem_escreve(self->mem_secundaria, end_secundario + i, valor);
+  /*o quadro pode estar compartilhado: sai da tabela de todos que o usam, e
+    cada um que alterou a pagina fica com a sua copia no disco; a primeira
+    vez que salva a página alterada, o processo ganha espaço para ela*/
+  for(int j = 0; j < MAX_PROCESSOS; j++){
+    processo_t *proc = &self->processos[j];
+    if(so_processo_usa_quadro(proc, pagina, quadro_fisico)
+       && tabpag_bit_alteracao(proc->tab_pag, pagina)
+       && proc->end_sec_pagina[pagina] == -1){
+      proc->end_sec_pagina[pagina] = so_aloca_pagina_secundaria(self);
+      if(proc->end_sec_pagina[pagina] == -1) return -1;
+    }
+  }
+  int n_copias = 0;
+  for(int j = 0; j < MAX_PROCESSOS; j++){
+    processo_t *proc = &self->processos[j];
+    if(!so_processo_usa_quadro(proc, pagina, quadro_fisico)) continue;
+    if(tabpag_bit_alteracao(proc->tab_pag, pagina)){   //pagina foi alterada
+      so_salva_copia_do_processo(self, proc, pagina, quadro_fisico);
+      n_copias++;
     }
-    tabpag_zera_bit_alterada(proc_substituido->tab_pag, pagina);
+    tabpag_invalida_pagina(proc->tab_pag, pagina);
+    proc->n_quadros--;
   }
-  tabpag_invalida_pagina(proc_substituido->tab_pag, pagina);
 
+  so_esquece_imagem(self, quadro_fisico);
+  so_tira_da_substituicao(self, quadro_fisico);
   self->quadros_livres[quadro_fisico] = true;   /*libera quadro*/
   self->quadro_processo[quadro_fisico] = -1;
+  self->quadro_pagina[quadro_fisico] = -1;
+  self->quadro_refs[quadro_fisico] = 0;
 
-  return 1;
+  return n_copias;
 }
 
-static void so_troca_carrega_pagina(so_t *self, int pagina){
-  /*somente copia*/
-  int end_secundario = self->processo_corrente->pos_ini_mem_sec + pagina * TAM_PAGINA;
-  int quadro_destino = so_proximo_quadro_livre(self);
-  if(quadro_destino == -1){
+// classe do quadro para o CLOCK (ver clock_classe_t em subs_pagina.h)
+// o quadro foi acessado ou alterado se algum dos processos que o usam o
+//   acessou ou alterou; o bit de alteração só conta no algoritmo 4
+// um quadro livre tem classe 0, é escolhido logo
+static int so_classe_quadro(void *arg, int quadro, bool zera_acesso){
+  so_t *self = arg;
+  int pagina = self->quadro_pagina[quadro];
+  int classe = 0;
+  for(int j = 0; j < MAX_PROCESSOS; j++){
+    processo_t *proc = &self->processos[j];
+    if(!so_processo_usa_quadro(proc, pagina, quadro)) continue;
+    if(tabpag_bit_acesso(proc->tab_pag, pagina)){
+      classe |= CLOCK_ACESSADO;
+      if(zera_acesso) tabpag_zera_bit_acesso(proc->tab_pag, pagina);
+    }
+    if(self->algortimo_substituicao == 4 && tabpag_bit_alteracao(proc->tab_pag, pagina))
+      classe |= CLOCK_ALTERADO;
+  }
+  return classe;
+}
+
+// retorna true se algum dos processos que usam o quadro o acessou desde a
+//   última verificação, e zera o bit de acesso deles
+static bool so_quadro_acessado(so_t *self, int quadro){
+  int pagina = self->quadro_pagina[quadro];
+  bool acessado = false;
+  for(int j = 0; j < MAX_PROCESSOS; j++){
+    processo_t *proc = &self->processos[j];
+    if(!so_processo_usa_quadro(proc, pagina, quadro)) continue;
+    if(tabpag_bit_acesso(proc->tab_pag, pagina)){
+      acessado = true;
+      tabpag_zera_bit_acesso(proc->tab_pag, pagina);
+    }
+  }
+  return acessado;
+}
+
+// retorna o tempo virtual do processo dono do quadro
+static int so_tempo_virtual_dono(so_t *self, int quadro){
+  int ind = encontra_indice_processo(self->processos, self->quadro_processo[quadro]);
+  if(ind == -1) return 0;
+  return self->processos[ind].t_cpu;
+}
+
+// idade do quadro para o WSClock (ver wsclock_idade_t em subs_pagina.h)
+// um quadro acessado desde a última verificação tem idade 0; um quadro livre
+//   é o mais velho possível, e é escolhido logo
+static int so_idade_quadro(void *arg, int quadro, bool *alterado){
+  so_t *self = arg;
+  *alterado = false;
+  if(self->quadros_livres[quadro]) return INT_MAX;
+  int agora = so_tempo_virtual_dono(self, quadro);
+  /*o último uso foi medido no tempo virtual do dono; se o quadro passou para
+    outro processo que o compartilha (ver so_solta_quadro), o tempo é outro,
+    e a idade recomeça*/
+  if(so_quadro_acessado(self, quadro) || self->quadro_ultimo_uso[quadro] > agora)
+    self->quadro_ultimo_uso[quadro] = agora;
+  /*o quadro está alterado se algum dos processos que o compartilham alterou,
+    então todos têm que ser vistos antes de decidir a idade*/
+  int pagina = self->quadro_pagina[quadro];
+  bool protegido = false;
+  for(int j = 0; j < MAX_PROCESSOS; j++){
+    processo_t *proc = &self->processos[j];
+    if(!so_processo_usa_quadro(proc, pagina, quadro)) continue;
+    if(tabpag_bit_alteracao(proc->tab_pag, pagina))
+      *alterado = true;
+    if(proc->n_quadros <= MIN_QUADROS_RESIDENTES)
+      protegido = true;
+  }
+  if(protegido) return 0;
+  return agora - self->quadro_ultimo_uso[quadro];
+}
+
+// escolhe um dos quadros usados pelo processo para ser substituído (segunda
+//   chance: um quadro acessado perde o bit de acesso e é escolhido só se
+//   todos tiverem sido acessados)
+// retorna -1 se o processo não usa nenhum quadro
+static int so_quadro_local_a_substituir(so_t *self, processo_t *proc){
+  for(int volta = 0; volta < 2; volta++){
+    for(int i = 0; i < self->n_quadros; i++){
+      int quadro = self->prox_quadro_local;
+      self->prox_quadro_local = (quadro + 1) % self->n_quadros;
+      if(self->quadros_livres[quadro]
+         || !so_processo_usa_quadro(proc, self->quadro_pagina[quadro], quadro))
+        continue;
+      if(volta == 0 && so_quadro_acessado(self, quadro)) continue;
+      return quadro;
+    }
+  }
+  return -1;
+}
+
+// retorna um quadro livre, substituindo uma página se não houver
+// com o controle de frequência de falhas, o processo corrente que já está
+//   na sua quota substitui uma das suas próprias páginas, a não ser que a
+//   memória esteja sobrando
+// retorna -1 se não conseguir (o processo corrente pode ter sido morto)
+static int so_obtem_quadro(so_t *self){
+  processo_t *proc = self->processo_corrente;
+  int quadro = -1;
+  // com memória sobrando, o processo que chegou na quota usa um quadro livre
+  //   em vez de substituir um dos seus; a quota não muda, e os quadros a mais
+  //   voltam para os outros pela substituição global quando a memória acabar
+  if(self->controle_pff && proc->n_quadros >= proc->quota_quadros
+     && !so_pff_memoria_sobrando(self)){
+    quadro = so_quadro_local_a_substituir(self, proc);
+    if(quadro != -1 && so_troca_salva_pagina(self, quadro) == -1){
+      so_chamada_mata_proc(self);
+      return -1;
+    }
+  }
+  if(quadro == -1)
+    quadro = so_proximo_quadro_livre(self);
+  if(quadro == -1){
     if(self->algortimo_substituicao == 1)
-      quadro_destino = FIFO_quadro_a_substituir(self->FIFO);
+      quadro = FIFO_quadro_a_substituir(self->FIFO);
+    else if(self->algortimo_substituicao == 2)
+      quadro = LRU_quadro_a_substituir(self->LRU);
+    else if(self->algortimo_substituicao <= 4)
+      quadro = CLOCK_quadro_a_substituir(self->CLOCK, so_classe_quadro, self);
     else
-      self->lista_quadros_LRU = LRU_quadro_a_substituir(self->lista_quadros_LRU, &quadro_destino);
+      quadro = WSCLOCK_quadro_a_substituir(self->CLOCK, JANELA_CONJUNTO_TRABALHO, so_idade_quadro, self);
     
-    if(quadro_destino == -1){
+    if(quadro == -1){
       console_printf("SO: nao ha paginas na FIFO");
-      return;
+      return -1;
     }
-    if(so_troca_salva_pagina(self, quadro_destino) == -1){
+    if(so_troca_salva_pagina(self, quadro) == -1){
       so_chamada_mata_proc(self);
-    return;
+      return -1;
     }
   }
+  return quadro;
+}
+
+// marca o quadro como ocupado pela página 'pagina' do processo corrente, e
+//   coloca o quadro no algoritmo de substituição
+static void so_ocupa_quadro(so_t *self, int quadro, int pagina){
+  self->quadros_livres[quadro] = false;
+  self->quadro_processo[quadro] = self->processo_corrente->id;
+  self->quadro_pagina[quadro] = pagina;
+  self->quadro_refs[quadro] = 1;
+  self->quadro_ultimo_uso[quadro] = self->processo_corrente->t_cpu;
+  self->processo_corrente->n_quadros++;
+  /*a página entra como acessada (o processo falhou ao acessá-la), senão
+    seria a primeira vítima do CLOCK ou da substituição local, antes mesmo
+    da instrução ser repetida*/
+  tabpag_marca_bit_acesso(self->processo_corrente->tab_pag, pagina, false);
+  if(self->algortimo_substituicao == 1)
+    fila_insere(self->FIFO, quadro);
+  else if(self->algortimo_substituicao == 2){
+    unsigned int env = soma_bit_mais_significativo(0);    //inicia como o último acessado
+    lru_insere(self->LRU, quadro, env);
+  }
+  else
+    rel_quadros_insere(self->CLOCK, quadro);
+}
+
+// envelhece os quadros de todos os processos, não só os do corrente (senão os
+//   quadros de processos bloqueados nunca envelhecem, e uma página recém
+//   trazida acaba sempre sendo a menos usada)
+// no WSClock, em vez de envelhecer, anota o tempo virtual dos acessos
+// visita ENVELHECIMENTO_PERCENTUAL dos quadros, continuando de onde parou
+static void so_envelhece_quadros(so_t *self){
+  int n = (self->n_quadros * ENVELHECIMENTO_PERCENTUAL + 99) / 100;
+  for(int i = 0; i < n; i++){
+    int quadro = self->prox_quadro_envelhecer;
+    self->prox_quadro_envelhecer = (quadro + 1) % self->n_quadros;
+    if(self->quadros_livres[quadro]) continue;
+    bool acessado = so_quadro_acessado(self, quadro);
+    if(self->algortimo_substituicao == 2)
+      lru_marca_envelhecimento(self->LRU, quadro, acessado);
+    else if(acessado)
+      self->quadro_ultimo_uso[quadro] = so_tempo_virtual_dono(self, quadro);
+  }
+  if(self->algortimo_substituicao == 2)
+    atualiza_envelhecimento(self->LRU);
+}
+
+// o processo 'id_proc' deixa de usar o quadro; o quadro só fica livre quando
+//   nenhum processo o usa mais
+static void so_solta_quadro(so_t *self, int quadro, int id_proc){
+  int ind = encontra_indice_processo(self->processos, id_proc);
+  if(ind != -1) self->processos[ind].n_quadros--;
+  self->quadro_refs[quadro]--;
+  if(self->quadro_refs[quadro] > 0){
+    if(self->quadro_processo[quadro] == id_proc){
+      /*o quadro passa a ser de outro processo que o compartilha*/
+      for(int i = 0; i < MAX_PROCESSOS; i++){
+        processo_t *proc = &self->processos[i];
+        if(proc->id != id_proc
+           && so_processo_usa_quadro(proc, self->quadro_pagina[quadro], quadro)){
+          self->quadro_processo[quadro] = proc->id;
+          break;
+        }
+      }
+    }
+    return;
+  }
+  so_esquece_imagem(self, quadro);
+  so_tira_da_substituicao(self, quadro);
+  self->quadros_livres[quadro] = true;
+  self->quadro_processo[quadro] = -1;
+  self->quadro_pagina[quadro] = -1;
+}
+
+// coloca a página 'pagina' do processo corrente em um quadro
+// retorna false se não foi preciso acessar a memória secundária, porque a
+//   página da imagem do programa já estava em um quadro, trazida por outro
+//   processo que executa o mesmo programa (ou se não foi possível obter um
+//   quadro; nesse caso o processo corrente pode ter sido morto)
+static bool so_troca_carrega_pagina(so_t *self, int pagina){
+  processo_t *proc = self->processo_corrente;
+  bool da_imagem = proc->end_sec_pagina[pagina] == -1;
+  imagem_t *imagem = &self->imagens[proc->imagem];
+  if(da_imagem && imagem->quadros[pagina] != -1){
+    /*compartilha o quadro, sem permissão de escrita*/
+    int quadro = imagem->quadros[pagina];
+    tabpag_define_quadro(proc->tab_pag, pagina, quadro);
+    tabpag_define_protecao(proc->tab_pag, pagina, TABPAG_EXECUCAO);
+    self->quadro_refs[quadro]++;
+    proc->n_quadros++;
+    return false;
+  }
+  /*somente copia*/
+  int end_secundario = so_end_secundario(self, proc, pagina);
+  int quadro_destino = so_obtem_quadro(self);
+  if(quadro_destino == -1) return false;
 
   for (int i = 0; i < TAM_PAGINA; i++) {
       int valor;
@@ -959,28 +1721,299 @@ static void so_troca_carrega_pagina(so_t *self, int pagina){
       mem_escreve(self->mem, quadro_destino * TAM_PAGINA + i, valor);   //endereço fisico: quadro_destino * TAM_PAGINA
   }
 
-  tabpag_define_quadro(self->processo_corrente->tab_pag, pagina, quadro_destino);
+  tabpag_define_quadro(proc->tab_pag, pagina, quadro_destino);
+  so_ocupa_quadro(self, quadro_destino, pagina);
+  if(da_imagem){
+    /*enquanto não for alterada, a página pode ser compartilhada*/
+    tabpag_define_protecao(proc->tab_pag, pagina, TABPAG_EXECUCAO);
+    imagem->quadros[pagina] = quadro_destino;
+    self->quadro_imagem[quadro_destino] = proc->imagem;
+  }
+  return true;
+}
 
-  self->quadros_livres[quadro_destino] = false;
-  self->quadro_processo[quadro_destino] = self->processo_corrente->id;
-  if(self->algortimo_substituicao == 1)
-    fila_insere(self->FIFO, quadro_destino);
-  else{
-    unsigned int env = soma_bit_mais_significativo(0);    //inicia como o último acessado
-    self->lista_quadros_LRU = lst_pag_insere_ordenado(self->lista_quadros_LRU, quadro_destino, env);
+// traz até 'n' páginas do processo corrente a partir de 'pagina', enquanto
+//   tiver quadros livres (e, com o controle de frequência de falhas, enquanto
+//   o processo estiver abaixo da sua quota ou a memória estiver sobrando),
+//   sem substituir nenhuma página
+// as páginas entram sem o bit de acesso, para serem as primeiras
+//   substituídas se não forem usadas
+// retorna o número de páginas trazidas da memória secundária
+static int so_adianta_paginas(so_t *self, int pagina, int n){
+  processo_t *proc = self->processo_corrente;
+  int n_lidas = 0;
+  for(int p = pagina; p < pagina + n && p < proc->n_paginas; p++){
+    int quadro;
+    if(tabpag_traduz(proc->tab_pag, p, &quadro) == ERR_OK) continue;
+    if(so_proximo_quadro_livre(self) == -1) break;
+    if(self->controle_pff && proc->n_quadros >= proc->quota_quadros
+       && !so_pff_memoria_sobrando(self)) break;
+    if(so_troca_carrega_pagina(self, p)) n_lidas++;
+    tabpag_zera_bit_acesso(proc->tab_pag, p);
   }
+  return n_lidas;
+}
 
+// retorna quantas páginas adiantar na falha na página 'pagina'
+// a falha continua uma sequência de acessos se é depois da última falha da
+//   sequência, e não depois das páginas adiantadas nela (que foram usadas
+//   até o fim, ou substituídas antes de serem usadas); cada processo tem
+//   SEQUENCIAS_POR_PROCESSO sequências, porque os acessos ao código e aos
+//   dados se intercalam
+// uma sequência que continua adianta o dobro de páginas; uma falha fora das
+//   sequências substitui a usada há mais tempo, adiantando uma página a
+//   menos que ela, para não ocupar o disco e os quadros com páginas inúteis
+//   no acesso aleatório
+static int so_adiantamento(processo_t *proc, int pagina){
+  int s;
+  for(s = 0; s < SEQUENCIAS_POR_PROCESSO; s++){
+    int ultima = proc->seq_ultima_falha[s];
+    if(ultima != -1 && pagina > ultima && pagina <= ultima + 1 + proc->seq_n_adiantar[s])
+      break;
+  }
+  int n;
+  if(s < SEQUENCIAS_POR_PROCESSO){
+    n = proc->seq_n_adiantar[s] == 0 ? 1 : proc->seq_n_adiantar[s] * 2;
+  }
+  else{
+    s = SEQUENCIAS_POR_PROCESSO - 1;
+    n = proc->seq_n_adiantar[s];
+    if(proc->seq_ultima_falha[s] != -1) n--;
+  }
+  if(n < PAGINAS_ADIANTADAS_MIN) n = PAGINAS_ADIANTADAS_MIN;
+  if(n > PAGINAS_ADIANTADAS_MAX) n = PAGINAS_ADIANTADAS_MAX;
+  /*a sequência passa a ser a mais recente*/
+  for(; s > 0; s--){
+    proc->seq_ultima_falha[s] = proc->seq_ultima_falha[s - 1];
+    proc->seq_n_adiantar[s] = proc->seq_n_adiantar[s - 1];
+  }
+  proc->seq_ultima_falha[0] = pagina;
+  proc->seq_n_adiantar[0] = n;
+  return n;
 }
 
+// traz a página da falha e as seguintes (quantas, depende do acesso ser
+//   sequencial) em uma só transferência, e bloqueia o processo até o disco
+//   avisar que ela terminou
+// se o disco não aceitar o pedido, o processo continua sem esperar (as
+//   páginas já estão na memória principal)
 static void trata_falha_pagina(so_t* self, int end_erro){
-  if(end_erro < 0 || end_erro >= self->processo_corrente->n_paginas * TAM_PAGINA){
+  processo_t *proc = self->processo_corrente;
+  if(end_erro < 0 || end_erro >= proc->n_paginas * TAM_PAGINA){
     so_chamada_mata_proc(self);
     return;
   }
   int pagina = end_erro/TAM_PAGINA;
-  so_troca_carrega_pagina(self, pagina);
-  self->processo_corrente->n_falha_paginas++;
-  atualiza_tempo_acesso_disco(self);
-  self->processo_corrente->espera = 3;
-  so_muda_estado_processo(self, self->processo_corrente->id, bloqueado);
+  if(!so_troca_carrega_pagina(self, pagina)) return;
+  int n_adiantadas = so_adianta_paginas(self, pagina + 1, so_adiantamento(proc, pagina));
+  proc->n_falha_paginas++;
+  proc->n_paginas_adiantadas += n_adiantadas;
+  proc->pedido_disco = so_pede_disco(self, 1 + n_adiantadas);
+  if(proc->pedido_disco == -1) return;
+  es_le(self->es, D_RELOGIO_INSTRUCOES, &proc->inicio_espera_disco);
+  proc->espera = 3;
+  so_muda_estado_processo(self, proc->id, bloqueado);
+}
+
+// acesso a uma página que a proteção não permite (escrita ou execução)
+// toda a memória dos processos pode ser alterada; uma página válida sem
+//   permissão de escrita está compartilhada com cópia na escrita (com a
+//   imagem do programa ou por so_chamada_duplica_proc): o processo recebe
+//   uma cópia só sua do quadro e repete a escrita
+// outras violações matam o processo
+static void trata_violacao_protecao(so_t* self, int end_erro){
+  processo_t *proc = self->processo_corrente;
+  int pagina = end_erro/TAM_PAGINA;
+  int quadro;
+  if(end_erro < 0 || tabpag_traduz(proc->tab_pag, pagina, &quadro) != ERR_OK
+     || (tabpag_protecao(proc->tab_pag, pagina) & TABPAG_ESCRITA)){
+    console_printf("SO: processo %d violou a proteção da página %d (end %d), matando processo",
+                   proc->id, pagina, end_erro);
+    so_chamada_mata_proc(self);
+    return;
+  }
+  if(self->quadro_refs[quadro] == 1){
+    /*os outros já fizeram suas cópias, o quadro é só deste processo*/
+    so_esquece_imagem(self, quadro);
+    tabpag_define_protecao(proc->tab_pag, pagina, TABPAG_PROT_TOTAL);
+    return;
+  }
+  int quadro_copia = so_obtem_quadro(self);
+  if(quadro_copia == -1) return;
+  int quadro_agora;
+  if(tabpag_traduz(proc->tab_pag, pagina, &quadro_agora) != ERR_OK){
+    /*o quadro compartilhado foi o substituído; a página volta do disco,
+      já privada, na falha de página da próxima tentativa*/
+    return;
+  }
+  for (int i = 0; i < TAM_PAGINA; i++) {
+    int valor;
+    mem_le(self->mem, quadro * TAM_PAGINA + i, &valor);
+    mem_escreve(self->mem, quadro_copia * TAM_PAGINA + i, valor);
+  }
+  so_solta_quadro(self, quadro, proc->id);
+  // o bit de alteração será marcado pela escrita repetida
+  tabpag_define_quadro(proc->tab_pag, pagina, quadro_copia);
+  so_ocupa_quadro(self, quadro_copia, pagina);
+}
+
+// ---------------------------------------------------------------------
+// CONTROLE DA FREQUÊNCIA DE FALHAS DE PÁGINA
+// ---------------------------------------------------------------------
+
+// quadros que podem ser usados pelos processos (os da memória protegida não)
+static int so_quadros_para_processos(so_t *self){
+  return self->n_quadros - (CPU_END_FIM_PROT / TAM_PAGINA + 1);
+}
+
+// retorna a soma das quotas dos processos que não estão suspensos
+static int so_pff_demanda(so_t *self){
+  int demanda = 0;
+  for(int i = 0; i < MAX_PROCESSOS; i++){
+    processo_t *proc = &self->processos[i];
+    if(proc->estado != morto && proc->estado != suspenso)
+      demanda += proc->quota_quadros;
+  }
+  return demanda;
+}
+
+// retorna true se sobra memória: os quadros livres são mais que a soma das
+//   quotas, então não adianta tirar quadros de ninguém
+static bool so_pff_memoria_sobrando(so_t *self){
+  int livres = 0;
+  for(int i = 0; i < self->n_quadros; i++){
+    if(self->quadros_livres[i]) livres++;
+  }
+  return livres > so_pff_demanda(self);
+}
+
+// libera os quadros do processo até ele ficar com no máximo 'n' quadros,
+//   começando pelos que não foram acessados
+// não libera nada enquanto sobrar memória
+static void so_pff_libera_quadros(so_t *self, processo_t *proc, int n){
+  if(so_pff_memoria_sobrando(self)) return;
+  while(proc->n_quadros > n){
+    int quadro = so_quadro_local_a_substituir(self, proc);
+    if(quadro == -1 || so_troca_salva_pagina(self, quadro) == -1) return;
+  }
+}
+
+// a demanda aumentou por causa do processo 'proc'; enquanto a soma das quotas
+//   não couber na memória, suspende o pronto (que não seja 'proc') que tem
+//   mais quadros; se não tiver nenhum, limita a quota de 'proc'
+static void so_pff_verifica_demanda(so_t *self, processo_t *proc){
+  int disponivel = so_quadros_para_processos(self);
+  while(so_pff_demanda(self) > disponivel){
+    processo_t *vitima = NULL;
+    for(int i = 0; i < MAX_PROCESSOS; i++){
+      processo_t *outro = &self->processos[i];
+      if(outro == proc || outro->estado != pronto) continue;
+      if(vitima == NULL || outro->n_quadros > vitima->n_quadros)
+        vitima = outro;
+    }
+    if(vitima == NULL){
+      proc->quota_quadros -= so_pff_demanda(self) - disponivel;
+      if(proc->quota_quadros < PFF_QUOTA_MIN) proc->quota_quadros = PFF_QUOTA_MIN;
+      return;
+    }
+    so_suspende_processo(self, vitima);
+  }
+}
+
+// ajusta a quota de quadros do processo pela frequência de falhas de página
+//   na última janela de PFF_JANELA instruções do seu tempo virtual
+// um processo que falha muito ganha quadros (podendo causar a suspensão de
+//   outros), um que quase não falha perde os quadros que não está usando,
+//   mas só se a memória não estiver sobrando
+static void so_pff_avalia(so_t *self, processo_t *proc){
+  if(proc->t_cpu - proc->pff_inicio_janela < PFF_JANELA) return;
+  int falhas = proc->n_falha_paginas - proc->pff_falhas_inicio;
+  proc->pff_inicio_janela = proc->t_cpu;
+  proc->pff_falhas_inicio = proc->n_falha_paginas;
+  if(falhas > PFF_MAX_FALHAS){
+    proc->quota_quadros += falhas - PFF_MAX_FALHAS;
+    so_pff_verifica_demanda(self, proc);
+  }
+  else if(falhas < PFF_MIN_FALHAS && proc->quota_quadros > PFF_QUOTA_MIN
+          && !so_pff_memoria_sobrando(self)){
+    proc->quota_quadros--;
+    so_pff_libera_quadros(self, proc, proc->quota_quadros);
+  }
+}
+
+// ---------------------------------------------------------------------
+// ESCALONADOR DE MÉDIO PRAZO
+// ---------------------------------------------------------------------
+
+// suspende o processo por falta de memória: os quadros só dele são
+//   liberados; dos compartilhados (imagem do programa ou cópia na escrita),
+//   que continuam com os outros processos, ele só solta a sua referência
+// as páginas que ele alterou são copiadas para a memória secundária em uma só
+//   transferência (o posicionamento do disco é pago uma vez), que ninguém
+//   espera terminar
+// o processo fica suspenso até ser reativado por so_escalona_medio_prazo
+static void so_suspende_processo(so_t *self, processo_t *proc){
+  int n_liberados = 0;
+  int n_soltos = 0;
+  int n_copias = 0;
+  tabpag_t *tab = proc->tab_pag;
+  for(int p = 0; p < tabpag_numero_pagina(tab); p++){
+    int quadro;
+    if(tabpag_traduz(tab, p, &quadro) != ERR_OK) continue;
+    if(self->quadro_refs[quadro] > 1){
+      if(tabpag_bit_alteracao(tab, p)){
+        if(!so_salva_copia_do_processo(self, proc, p, quadro)) break;
+        n_copias++;
+      }
+      tabpag_invalida_pagina(tab, p);
+      so_solta_quadro(self, quadro, proc->id);
+      n_soltos++;
+      continue;
+    }
+    int n = so_troca_salva_pagina(self, quadro);
+    if(n == -1) break;
+    n_copias += n;
+    n_liberados++;
+  }
+  if(n_copias > 0)
+    so_pede_disco(self, n_copias);
+  console_printf("SO: processo %d suspenso por falta de memória, %d quadros liberados, %d compartilhados soltos, %d páginas copiadas",
+                 proc->id, n_liberados, n_soltos, n_copias);
+  so_muda_estado_processo(self, proc->id, suspenso);
+}
+
+// decide quais processos ficam na memória: com o controle de frequência de
+//   falhas, suspende processos enquanto a soma das quotas não couber na
+//   memória, ou reativa um processo suspenso se a sua quota couber
+// um de cada vez, para que a demanda seja reavaliada depois que o reativado
+//   voltar a executar
+// se não tiver processo pronto para executar nem esperando o disco (os outros
+//   podem estar esperando pelos suspensos), reativa um mesmo que não caiba,
+//   com a quota reduzida
+static void so_escalona_medio_prazo(so_t *self){
+  if(!self->controle_pff) return;
+  int livre = so_quadros_para_processos(self) - so_pff_demanda(self);
+  if(livre < 0){
+    if(self->processo_corrente != NULL && self->processo_corrente->estado != morto)
+      so_pff_verifica_demanda(self, self->processo_corrente);
+    return;
+  }
+  bool ocioso = self->ini_fila_proc_prontos == NULL
+             && (self->processo_corrente == NULL || self->processo_corrente->estado != pronto);
+  for(int i = 0; i < MAX_PROCESSOS; i++){
+    if(self->processos[i].estado == bloqueado && self->processos[i].espera == 3)
+      ocioso = false;
+  }
+  for(int i = 0; i < MAX_PROCESSOS; i++){
+    processo_t *proc = &self->processos[i];
+    if(proc->estado != suspenso) continue;
+    if(ocioso && proc->quota_quadros > livre){
+      proc->quota_quadros = livre > PFF_QUOTA_MIN ? livre : PFF_QUOTA_MIN;
+    }
+    if(proc->quota_quadros <= livre || ocioso){
+      console_printf("SO: processo %d reativado", proc->id);
+      so_muda_estado_processo(self, proc->id, pronto);
+      return;
+    }
+  }
 }
@@ -14,8 +14,18 @@ typedef struct so_t so_t;
 #include "es.h"
 #include "console.h" // só para uma gambiarra
 
+// cria o SO
+// 'algoritmo_substituicao' escolhe a substituição de páginas: 1 = FIFO,
+//   2 = LRU, 3 = CLOCK, 4 = CLOCK com bit de alteração, 5 = WSClock
+// com 'controle_pff', cada processo tem uma quota de quadros controlada pela
+//   sua frequência de falhas de página, e processos são suspensos quando a
+//   soma das quotas não cabe na memória
+// 'programa_inicial' é o arquivo com o programa do primeiro processo
+//   (normalmente "init.maq")
+// usa toda a memória 'mem' (até MEM_TAM)
 so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu,
-    es_t *es, console_t *console, mem_t *mem_sec);
+    es_t *es, console_t *console, mem_t *mem_sec,
+    int algoritmo_substituicao, bool controle_pff, char *programa_inicial);
 
 void so_destroi(so_t *self);
 typedef enum { simples, round_robin, prioridade} escalonador_atual;
@@ -79,14 +89,27 @@ typedef enum { simples, round_robin, prioridade} escalonador_atual;
 // retorna sem bloquear, com erro, se não existir processo com esse pid
 #define SO_ESPERA_PROC 9
 
-#define TIPOS_IRQ 6
+// cria um processo novo, que é uma cópia do processo que realiza esta
+//   chamada: executa o mesmo programa, a partir do mesmo ponto, com uma
+//   cópia da memória e dos registradores
+// a memória é copiada só quando alterada (cópia na escrita), então a criação
+//   é barata mesmo para programas grandes
+// retorna em A: para o processo chamador, o pid do processo criado ou um
+//   código de erro negativo; para o processo criado, 0
+#define SO_DUPLICA_PROC 10
+
+#define TIPOS_IRQ 7
 
 #define QUANTUM_INICIAL 5
 
 #define ESPERA_ACESSO_SECUNDARIA 50
+// tempo de cada página a mais em uma transferência de várias páginas com a
+//   memória secundária (o posicionamento, ESPERA_ACESSO_SECUNDARIA, é pago
+//   uma vez por transferência)
+#define ESPERA_PAGINA_LOTE 5
 
 // constantes
-#define MEM_TAM 10000        // tamanho da memória principal
+#define MEM_TAM 10000        // tamanho máximo da memória principal (ver main -m)
 #define QUANT_QUADROS MEM_TAM/TAM_PAGINA
 #define QUANT_PAGINAS (QUANT_QUADROS * 5)
 
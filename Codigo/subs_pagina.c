@@ -1,5 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
 
 #include "tabpag.h"
 #include "so.h"
@@ -11,62 +14,70 @@
 
 // FUNÇÕES AUXILIARES DE FILA
 
+// liga ou desliga o bit do quadro 'id' no mapa de quadros na fila
+static void fila_marca(FIFO *f, int id, bool na_fila){
+    uint32_t bit = (uint32_t)1 << (id % FILA_BITS_POR_PALAVRA);
+    if(na_fila)
+        f->na_fila[id / FILA_BITS_POR_PALAVRA] |= bit;
+    else
+        f->na_fila[id / FILA_BITS_POR_PALAVRA] &= ~bit;
+}
+
 FIFO* fila_cria (void){
     FIFO *f = (FIFO*) malloc(sizeof(FIFO));
-    f->inicio = NULL;
-    f->fim = NULL;
+    assert(f != NULL);
+    f->inicio = 0;
+    f->n = 0;
+    memset(f->na_fila, 0, sizeof(f->na_fila));
     return f;
 }
 
 void fila_libera (FIFO *f){
-    Lst_quadros_FIFO *l = f->inicio;
-    while (l != NULL){
-        Lst_quadros_FIFO *aux = l->prox;
-        free(l);
-        l = aux;
-    }
     free(f);
 }
 
 int fila_vazia (FIFO *f){
-    return (f->inicio == NULL);
+    return (f->n == 0);
 }
 
 void fila_insere (FIFO *f, int id){
     if(fila_busca(f, id) == 1) return;
-    Lst_quadros_FIFO *novo = (Lst_quadros_FIFO*) malloc(sizeof(Lst_quadros_FIFO));
-    novo->id_quadro = id;
-    novo->prox = NULL;
-    if(!fila_vazia(f))
-        f->fim->prox = novo;
-    else
-        f->inicio = novo;
-    f->fim = novo;
+    // cada quadro está no máximo uma vez na fila, então sempre cabe
+    f->quadros[(f->inicio + f->n) % FILA_CAPACIDADE] = id;
+    f->n++;
+    fila_marca(f, id, true);
 }
 
 int fila_busca(FIFO *f, int id) {
-    Lst_quadros_FIFO *l = f->inicio;
-    while (l != NULL) {
-        if (l->id_quadro == id) return 1;
-        l = l->prox;
-    }
-    return 0;
+    uint32_t bit = (uint32_t)1 << (id % FILA_BITS_POR_PALAVRA);
+    return (f->na_fila[id / FILA_BITS_POR_PALAVRA] & bit) != 0;
 }
 
 int fila_retira (FIFO *f){
-    Lst_quadros_FIFO *l = f->inicio;
     if (fila_vazia(f)) {
         printf("A fila ja esta vazia\n");
         return -1;
     }
-    int v = l->id_quadro;
-    f->inicio = l->prox;
-    if (fila_vazia(f))
-        f->fim = NULL;
-    free(l);
+    int v = f->quadros[f->inicio];
+    f->inicio = (f->inicio + 1) % FILA_CAPACIDADE;
+    f->n--;
+    fila_marca(f, v, false);
     return v;
 }
 
+// tira o quadro 'id' da fila, onde quer que ele esteja (o quadro foi liberado
+//   e, quando voltar a ser usado, entra no fim da fila)
+void fila_remove (FIFO *f, int id){
+    if(!fila_busca(f, id)) return;
+    int i = 0;
+    while(f->quadros[(f->inicio + i) % FILA_CAPACIDADE] != id) i++;
+    // os quadros depois dele andam uma posição para a frente
+    for(; i < f->n - 1; i++)
+        f->quadros[(f->inicio + i) % FILA_CAPACIDADE] = f->quadros[(f->inicio + i + 1) % FILA_CAPACIDADE];
+    f->n--;
+    fila_marca(f, id, false);
+}
+
 // FUNÇÃO DE SUBSTITUIÇÃO POR FIFO
 
 int FIFO_quadro_a_substituir(FIFO *f){
@@ -75,116 +86,271 @@ int FIFO_quadro_a_substituir(FIFO *f){
 
 
 // ---------------------------------------------------------------------
-// LISTA DE QUADROS - IMPLEMENTAÇÃO DE SUBSTITUIÇÃO POR LRU
+// HEAP DE QUADROS - IMPLEMENTAÇÃO DE SUBSTITUIÇÃO POR LRU (ENVELHECIMENTO)
 // ---------------------------------------------------------------------
 
-// FUNÇÕES AUXILIARES DE LISTA
+// FUNÇÕES AUXILIARES DE HEAP
 
-void lst_pag_libera(Lista_quadros* l){
-    Lista_quadros* p = l;
-    while(p != NULL){
-        Lista_quadros* t = p->prox;
-        free(p);
-        p = t;
-    }
+// true se o quadro 'a' deve sair antes do quadro 'b': menor envelhecimento
+//   (menos usado recentemente); em caso de empate, o que entrou antes
+static bool lru_antes(LRU *l, int a, int b){
+    if(l->envelhecimento[a] != l->envelhecimento[b])
+        return l->envelhecimento[a] < l->envelhecimento[b];
+    return l->chegada[a] < l->chegada[b];
 }
 
-int lst_pag_vazia(Lista_quadros* l){
-    return (l == NULL);
+static void lru_troca(LRU *l, int i, int j){
+    int qi = l->heap[i], qj = l->heap[j];
+    l->heap[i] = qj;
+    l->heap[j] = qi;
+    l->posicao[qj] = i;
+    l->posicao[qi] = j;
 }
 
-Lista_quadros* lst_pag_insere_ordenado(Lista_quadros* l, int id, unsigned int env){
-    if(lst_pag_busca(l, id) != NULL)        //se ja esta na LRU, somente retorna
-        return l;
-    Lista_quadros* novo;
-    Lista_quadros* ant = NULL; /* ponteiro para elemento anterior */
-    Lista_quadros* p = l; /* ponteiro para percorrer a lista */
-    /* procura posição de inserção */
-    while (p != NULL && p->envelhecimento <= env){ 
-        ant = p; 
-        p = p->prox; 
+static void lru_sobe(LRU *l, int i){
+    while(i > 0){
+        int pai = (i - 1) / 2;
+        if(!lru_antes(l, l->heap[i], l->heap[pai])) break;
+        lru_troca(l, i, pai);
+        i = pai;
     }
-    /* cria novo elemento */
-    novo = (Lista_quadros*)malloc(sizeof(Lista_quadros));
-    novo->id_quadro = id;
-    novo->envelhecimento = env;
-    /* encadeia elemento */
-    if (ant == NULL){
-        novo->prox = l; 
-        l = novo; 
-    }
-    else {
-        novo->prox = ant->prox;
-        ant->prox = novo; 
+}
+
+static void lru_desce(LRU *l, int i){
+    for(;;){
+        int menor = i;
+        int esq = 2 * i + 1, dir = 2 * i + 2;
+        if(esq < l->n && lru_antes(l, l->heap[esq], l->heap[menor])) menor = esq;
+        if(dir < l->n && lru_antes(l, l->heap[dir], l->heap[menor])) menor = dir;
+        if(menor == i) break;
+        lru_troca(l, i, menor);
+        i = menor;
     }
+}
+
+// reorganiza o heap inteiro (O(n)), depois que o envelhecimento mudou
+static void lru_organiza(LRU *l){
+    for(int i = l->n / 2 - 1; i >= 0; i--)
+        lru_desce(l, i);
+    l->desorganizado = false;
+}
+
+LRU* lru_cria (void){
+    LRU *l = (LRU*) malloc(sizeof(LRU));
+    assert(l != NULL);
+    l->n = 0;
+    l->proxima_chegada = 0;
+    l->desorganizado = false;
+    for(int q = 0; q < LRU_CAPACIDADE; q++)
+        l->posicao[q] = -1;
+    memset(l->envelhecimento, 0, sizeof(l->envelhecimento));
+    memset(l->envelhecer, 0, sizeof(l->envelhecer));
+    memset(l->acessados, 0, sizeof(l->acessados));
     return l;
 }
 
-Lista_quadros* lst_pag_retira_primeira(Lista_quadros* l){
-    if (l == NULL)
-        return l;
+void lru_libera (LRU *l){
+    free(l);
+}
 
-    Lista_quadros* p = l;
-    l = p->prox; 
+int lru_vazia (LRU *l){
+    return (l->n == 0);
+}
 
-    free(p);
-    return l;
+int lru_busca(LRU *l, int id){
+    return l->posicao[id] != -1;
+}
+
+void lru_insere (LRU *l, int id, unsigned int env){
+    if(lru_busca(l, id))        //se ja esta na LRU, somente retorna
+        return;
+    l->envelhecimento[id] = env;
+    l->chegada[id] = l->proxima_chegada++;
+    l->heap[l->n] = id;
+    l->posicao[id] = l->n;
+    l->n++;
+    // se o heap vai ser reorganizado de qualquer forma, não precisa subir
+    if(!l->desorganizado)
+        lru_sobe(l, l->n - 1);
+}
+
+int lru_retira (LRU *l){
+    if(lru_vazia(l)) return -1;
+    if(l->desorganizado) lru_organiza(l);
+    int v = l->heap[0];
+    lru_troca(l, 0, l->n - 1);
+    l->n--;
+    l->posicao[v] = -1;
+    lru_desce(l, 0);
+    return v;
 }
 
-Lista_quadros* lst_pag_busca(Lista_quadros* l, int id){
-    Lista_quadros* p;
-    for (p = l; p != NULL; p = p->prox){
-        if(p->id_quadro == id)
-            return p;
+// tira o quadro 'id' do heap (o quadro foi liberado); o contador dele é
+//   esquecido, e recomeça quando o quadro for inserido de novo
+void lru_remove (LRU *l, int id){
+    if(!lru_busca(l, id)) return;
+    int i = l->posicao[id];
+    lru_troca(l, i, l->n - 1);
+    l->n--;
+    l->posicao[id] = -1;
+    uint32_t bit = (uint32_t)1 << (id % LRU_BITS_POR_PALAVRA);
+    l->envelhecer[id / LRU_BITS_POR_PALAVRA] &= ~bit;
+    l->acessados[id / LRU_BITS_POR_PALAVRA] &= ~bit;
+    // o quadro que ocupou o lugar dele pode ter que subir ou descer
+    if(i < l->n && !l->desorganizado){
+        int q = l->heap[i];
+        lru_sobe(l, i);
+        lru_desce(l, l->posicao[q]);
     }
-    return NULL;
 }
 
 unsigned int soma_bit_mais_significativo(unsigned int valor){
-    unsigned int mascara = 1, aux;
-    while((aux = mascara << 1) != 0){
-        mascara <<= 1;
-    }
-    return valor | mascara;     //soma valor com mascara = 1 no bit mais significativo
-}
-
-void atualiza_envelhecimento(Lista_quadros* l, tabpag_t *tab, int quadro_processo[QUANT_QUADROS], int id_proc) {
-    Lista_quadros *aux = l;
-    while (aux != NULL) {
-        if(quadro_processo[aux->id_quadro] == id_proc){
-            int pagina = tabpag_encontra_pagina_pelo_quadro(tab, aux->id_quadro);
-            if (pagina != -1) {
-                aux->envelhecimento >>= 1;
-                if (tabpag_bit_acesso(tab, pagina)) {
-                    aux->envelhecimento = soma_bit_mais_significativo(aux->envelhecimento);
-                    tabpag_zera_bit_acesso(tab, pagina);
-                }
-            }
+    return valor | ~(~0u >> 1);     //soma valor com mascara = 1 no bit mais significativo
+}
+
+// desloca o contador dos quadros marcados em 'envelhecer', colocando no bit
+//   mais significativo o bit do quadro em 'acessados', e desmarca os mapas
+// os demais contadores não mudam (deslocamento de 0 bits)
+static void lru_envelhece(LRU *l){
+    for(int w = 0; w < LRU_PALAVRAS; w++){
+        uint32_t envelhecer = l->envelhecer[w];
+        uint32_t acessados = l->acessados[w];
+        uint32_t *env = &l->envelhecimento[w * LRU_BITS_POR_PALAVRA];
+        for(int b = 0; b < LRU_BITS_POR_PALAVRA; b++){
+            uint32_t desloca = (envelhecer >> b) & 1;
+            uint32_t acessado = (acessados >> b) & 1;
+            env[b] = (env[b] >> desloca) | (acessado << (LRU_BITS_POR_PALAVRA - 1));
         }
-        aux = aux->prox;
+        l->envelhecer[w] = 0;
+        l->acessados[w] = 0;
     }
 }
 
-Lista_quadros* lst_pag_ordena(Lista_quadros* l){
-    Lista_quadros* nova = NULL;
-    Lista_quadros* p = l;
-    while(p != NULL){
-        nova = lst_pag_insere_ordenado(nova, p->id_quadro, p->envelhecimento);
-        p = p->prox;
-    }
-    lst_pag_libera(l);   // libera lista antiga
-    return nova;         // retorna lista ordenada
+// marca o quadro para ser envelhecido na próxima atualização, como acessado
+//   ou não; não faz nada se o quadro não estiver no heap
+void lru_marca_envelhecimento(LRU *l, int id, bool acessado){
+    if(!lru_busca(l, id)) return;
+    uint32_t bit = (uint32_t)1 << (id % LRU_BITS_POR_PALAVRA);
+    l->envelhecer[id / LRU_BITS_POR_PALAVRA] |= bit;
+    if(acessado)
+        l->acessados[id / LRU_BITS_POR_PALAVRA] |= bit;
+    l->desorganizado = true;
+}
+
+// envelhece os quadros marcados por lru_marca_envelhecimento
+// só altera os contadores; o heap é reorganizado uma vez, na próxima retirada
+void atualiza_envelhecimento(LRU *l) {
+    if(!l->desorganizado) return;
+    lru_envelhece(l);
 }
 
 // FUNÇÃO DE SUBSTITUIÇÃO POR LRU
 
-Lista_quadros* LRU_quadro_a_substituir(Lista_quadros* l, int *quadro){
-    if(l == NULL) return NULL;
+int LRU_quadro_a_substituir(LRU *l){
+    return lru_retira(l);
+}
 
-    l = lst_pag_ordena(l);
-    *quadro = l->id_quadro;
+// ---------------------------------------------------------------------
+// RELÓGIO DE QUADROS - IMPLEMENTAÇÃO DE SUBSTITUIÇÃO POR CLOCK
+// ---------------------------------------------------------------------
 
-    l = lst_pag_retira_primeira(l);
-    return l;
+// FUNÇÕES AUXILIARES DO RELÓGIO
+
+Relogio_quadros* rel_quadros_cria (void){
+    Relogio_quadros *r = (Relogio_quadros*) malloc(sizeof(Relogio_quadros));
+    assert(r != NULL);
+    memset(r->no_relogio, 0, sizeof(r->no_relogio));
+    r->ponteiro = 0;
+    r->n = 0;
+    return r;
+}
+
+void rel_quadros_libera (Relogio_quadros *r){
+    free(r);
+}
+
+int rel_quadros_busca (Relogio_quadros *r, int id){
+    uint32_t bit = (uint32_t)1 << (id % CLOCK_BITS_POR_PALAVRA);
+    return (r->no_relogio[id / CLOCK_BITS_POR_PALAVRA] & bit) != 0;
+}
+
+void rel_quadros_insere (Relogio_quadros *r, int id){
+    if(rel_quadros_busca(r, id)) return;
+    r->no_relogio[id / CLOCK_BITS_POR_PALAVRA] |= (uint32_t)1 << (id % CLOCK_BITS_POR_PALAVRA);
+    r->n++;
 }
 
+void rel_quadros_retira (Relogio_quadros *r, int id){
+    if(!rel_quadros_busca(r, id)) return;
+    r->no_relogio[id / CLOCK_BITS_POR_PALAVRA] &= ~((uint32_t)1 << (id % CLOCK_BITS_POR_PALAVRA));
+    r->n--;
+}
+
+// FUNÇÃO DE SUBSTITUIÇÃO POR CLOCK
+
+// escolhe e retira do relógio o quadro a substituir, ou retorna -1 se o
+//   relógio estiver vazio
+// o ponteiro dá até 4 voltas: nas voltas pares procura um quadro não acessado
+//   e não alterado, sem mexer nos bits; nas ímpares aceita também um quadro
+//   alterado não acessado, e zera o bit de acesso dos quadros por onde passa
+// um quadro alterado só é escolhido se não houver um não alterado, porque
+//   precisa ser copiado para a memória secundária; se 'classe' nunca informa
+//   alteração, é o CLOCK simples
+int CLOCK_quadro_a_substituir(Relogio_quadros *r, clock_classe_t classe, void *arg){
+    if(r->n == 0) return -1;
+    for(int volta = 0; volta < 4; volta++){
+        bool zera = (volta % 2 == 1);
+        for(int i = 0; i < CLOCK_CAPACIDADE; i++){
+            int q = r->ponteiro;
+            r->ponteiro = (q + 1) % CLOCK_CAPACIDADE;
+            if(!rel_quadros_busca(r, q)) continue;
+            int c = classe(arg, q, zera);
+            if(c == 0 || (zera && c == CLOCK_ALTERADO)){
+                rel_quadros_retira(r, q);
+                return q;
+            }
+        }
+    }
+    // não acontece: depois da segunda volta nenhum quadro está acessado
+    return -1;
+}
+
+// FUNÇÃO DE SUBSTITUIÇÃO POR WSCLOCK
+
+// escolhe e retira do relógio o quadro a substituir, ou retorna -1 se o
+//   relógio estiver vazio
+// o ponteiro dá no máximo uma volta, e para no primeiro quadro fora do
+//   conjunto de trabalho (mais velho que 'janela') e não alterado
+// se não achar, escolhe o mais velho dos alterados fora do conjunto de
+//   trabalho (que será copiado para a memória secundária), ou, se todos os
+//   quadros estão no conjunto de trabalho, o mais velho de todos (qualquer
+//   idade serve, então sempre tem um quadro escolhido)
+int WSCLOCK_quadro_a_substituir(Relogio_quadros *r, int janela, wsclock_idade_t idade, void *arg){
+    if(r->n == 0) return -1;
+    int velho_alterado = -1, idade_velho_alterado = INT_MIN;
+    int mais_velho = -1, idade_mais_velho = INT_MIN;
+    for(int i = 0; i < CLOCK_CAPACIDADE; i++){
+        int q = r->ponteiro;
+        r->ponteiro = (q + 1) % CLOCK_CAPACIDADE;
+        if(!rel_quadros_busca(r, q)) continue;
+        bool alterado;
+        int id = idade(arg, q, &alterado);
+        if(id > janela && !alterado){
+            rel_quadros_retira(r, q);
+            return q;
+        }
+        if(id > janela && id > idade_velho_alterado){
+            velho_alterado = q;
+            idade_velho_alterado = id;
+        }
+        if(id > idade_mais_velho){
+            mais_velho = q;
+            idade_mais_velho = id;
+        }
+    }
+    int q = velho_alterado != -1 ? velho_alterado : mais_velho;
+    assert(q != -1);
+    rel_quadros_retira(r, q);
+    r->ponteiro = (q + 1) % CLOCK_CAPACIDADE;
+    return q;
+}
@@ -1,15 +1,20 @@
 #ifndef SUBS_PAGINA_H
 #define SUBS_PAGINA_H
 
-struct lst_quadros {
-    int id_quadro;
-    struct lst_quadros* prox;
-};
-typedef struct lst_quadros Lst_quadros_FIFO;
+#include <stdint.h>
+
+// fila de quadros em um vetor circular, com capacidade para todos os quadros
+// cada quadro está no máximo uma vez na fila; um mapa de bits diz quais estão,
+//   para que inserção, retirada e busca não precisem percorrer a fila nem
+//   alocar memória
+#define FILA_CAPACIDADE (QUANT_QUADROS)
+#define FILA_BITS_POR_PALAVRA 32
 
 struct fila{
-    Lst_quadros_FIFO *inicio;
-    Lst_quadros_FIFO *fim;   
+    int quadros[FILA_CAPACIDADE];
+    int inicio;     // posição do primeiro quadro da fila em 'quadros'
+    int n;          // número de quadros na fila
+    uint32_t na_fila[(FILA_CAPACIDADE + FILA_BITS_POR_PALAVRA - 1) / FILA_BITS_POR_PALAVRA];
 };
 typedef struct fila FIFO;
 
@@ -19,25 +24,88 @@ int fila_vazia (FIFO* f);
 void fila_insere (FIFO* f, int id);
 int fila_busca(FIFO *f, int id);
 int fila_retira (FIFO* f);
+void fila_remove (FIFO* f, int id);
 int FIFO_quadro_a_substituir(FIFO *f);
 
 
-struct lista_quadros {
-    int id_quadro;
-    unsigned int envelhecimento;
-    struct lista_quadros* prox;
+// quadros em um heap indexado pelo envelhecimento (aproximação do LRU)
+// o envelhecimento de cada quadro fica em um vetor indexado pelo quadro, e
+//   a posição de cada quadro no heap também, para que a escolha da vítima
+//   seja O(log n) e a inserção e busca não precisem percorrer os quadros
+// o envelhecimento é alterado sem mexer no heap, que é reorganizado de uma
+//   vez (O(n)) só quando uma vítima for necessária
+// a cada envelhecimento, os quadros a envelhecer e os acessados são marcados
+//   em mapas de bits, e os contadores de todos os quadros são atualizados
+//   por um laço sem desvios sobre o vetor, que o compilador pode vetorizar
+#define LRU_CAPACIDADE (QUANT_QUADROS)
+#define LRU_BITS_POR_PALAVRA 32
+#define LRU_PALAVRAS ((LRU_CAPACIDADE + LRU_BITS_POR_PALAVRA - 1) / LRU_BITS_POR_PALAVRA)
+
+struct lru{
+    // tem uma palavra de mapa de bits para cada LRU_BITS_POR_PALAVRA contadores
+    uint32_t envelhecimento[LRU_PALAVRAS * LRU_BITS_POR_PALAVRA];
+    uint32_t envelhecer[LRU_PALAVRAS];      // quadros a envelhecer na próxima atualização
+    uint32_t acessados[LRU_PALAVRAS];       // desses, os que foram acessados
+    unsigned int chegada[LRU_CAPACIDADE];   // ordem de inserção, para desempate
+    int posicao[LRU_CAPACIDADE];            // posição do quadro em 'heap', -1 se não está
+    int heap[LRU_CAPACIDADE];               // quadros, o próximo a sair em heap[0]
+    int n;                                  // número de quadros no heap
+    unsigned int proxima_chegada;
+    bool desorganizado;                     // envelhecimento mudou desde a última organização
 };
-typedef struct lista_quadros Lista_quadros;
+typedef struct lru LRU;
 
-void lst_pag_libera(Lista_quadros* l);
-int lst_pag_vazia(Lista_quadros* l);
-Lista_quadros* lst_pag_insere_ordenado(Lista_quadros* l, int id, unsigned int env);
-Lista_quadros* lst_pag_retira_primeira(Lista_quadros* l);
-Lista_quadros* lst_pag_busca(Lista_quadros* l, int id);
+LRU* lru_cria (void);
+void lru_libera (LRU *l);
+int lru_vazia (LRU *l);
+void lru_insere (LRU *l, int id, unsigned int env);
+int lru_busca(LRU *l, int id);
+int lru_retira (LRU *l);
+void lru_remove (LRU *l, int id);
 
 unsigned int soma_bit_mais_significativo(unsigned int valor);
-void atualiza_envelhecimento(Lista_quadros* l, tabpag_t *tab, int quadro_processo[QUANT_QUADROS], int id_proc);
-Lista_quadros* lst_pag_ordena(Lista_quadros* l);
-Lista_quadros* LRU_quadro_a_substituir(Lista_quadros* l, int *quadro);
+void lru_marca_envelhecimento(LRU *l, int id, bool acessado);
+void atualiza_envelhecimento(LRU *l);
+int LRU_quadro_a_substituir(LRU *l);
+
+// quadros em um vetor circular percorrido por um ponteiro (CLOCK, ou segunda
+//   chance), indexado pelo número do quadro; um mapa de bits diz quais
+//   quadros estão no relógio
+// os bits de acesso e alteração ficam nas tabelas de páginas, e são obtidos
+//   por uma função do SO (ver CLOCK_quadro_a_substituir)
+#define CLOCK_CAPACIDADE (QUANT_QUADROS)
+#define CLOCK_BITS_POR_PALAVRA 32
+
+struct relogio_quadros{
+    uint32_t no_relogio[(CLOCK_CAPACIDADE + CLOCK_BITS_POR_PALAVRA - 1) / CLOCK_BITS_POR_PALAVRA];
+    int ponteiro;   // próximo quadro a examinar
+    int n;          // número de quadros no relógio
+};
+typedef struct relogio_quadros Relogio_quadros;
+
+// classe de um quadro para a substituição: bit 1 ligado se o quadro foi
+//   acessado, bit 0 ligado se foi alterado
+#define CLOCK_ACESSADO  (1 << 1)
+#define CLOCK_ALTERADO  (1 << 0)
+// retorna a classe do quadro 'quadro'; se 'zera_acesso' for true, zera o bit
+//   de acesso depois de obter a classe (o quadro ganha uma segunda chance)
+typedef int (*clock_classe_t)(void *arg, int quadro, bool zera_acesso);
+
+Relogio_quadros* rel_quadros_cria (void);
+void rel_quadros_libera (Relogio_quadros *r);
+void rel_quadros_insere (Relogio_quadros *r, int id);
+int rel_quadros_busca (Relogio_quadros *r, int id);
+void rel_quadros_retira (Relogio_quadros *r, int id);
+int CLOCK_quadro_a_substituir(Relogio_quadros *r, clock_classe_t classe, void *arg);
+
+// WSClock usa o mesmo relógio de quadros, mas escolhe pela idade do quadro:
+//   o tempo virtual (instruções executadas) do processo dono desde o último
+//   acesso ao quadro; um quadro mais velho que a janela está fora do conjunto
+//   de trabalho do processo
+// retorna a idade do quadro 'quadro' (não negativa), e em 'alterado' se ele
+//   precisa ser copiado para a memória secundária antes de ser substituído
+typedef int (*wsclock_idade_t)(void *arg, int quadro, bool *alterado);
+
+int WSCLOCK_quadro_a_substituir(Relogio_quadros *r, int janela, wsclock_idade_t idade, void *arg);
 
 #endif
@@ -5,35 +5,94 @@
 
 #include "tabpag.h"
 #include <stdlib.h>
+#include <stdint.h>
 #include <assert.h>
 
-// estrutura auxiliar, contém informação sobre uma página
-typedef struct {
-  // quadro da memória principal correspondente à página
-  int quadro;
-  // a página está mapeada ou não
-  bool valida;
-  // a página foi acessada ou não
-  bool acessada;
-  // a página foi alterada ou não
-  bool alterada;
-} descritor_t;
+// descritor de uma página, empacotado em 32 bits
+//   bit 0      a página está mapeada ou não
+//   bit 1      a página foi acessada ou não
+//   bit 2      a página foi alterada ou não
+//   bits 3-4   proteção (TABPAG_ESCRITA e TABPAG_EXECUCAO)
+//   bits 5-7   não usados
+//   bits 8-31  quadro da memória principal correspondente à página
+// um descritor zerado é uma página inválida
+typedef uint32_t descritor_t;
+
+#define DESC_VALIDA    (1u << 0)
+#define DESC_ACESSADA  (1u << 1)
+#define DESC_BIT_ALTERADA 2
+#define DESC_ALTERADA  (1u << DESC_BIT_ALTERADA)
+#define DESC_DESLOCAMENTO_PROTECAO 3
+#define DESC_PROTECAO  (TABPAG_PROT_TOTAL << DESC_DESLOCAMENTO_PROTECAO)
+#define DESC_DESLOCAMENTO_QUADRO 8
+#define DESC_MAX_QUADRO ((1 << (32 - DESC_DESLOCAMENTO_QUADRO)) - 1)
+
+// retorna o quadro do descritor
+static int desc_quadro(descritor_t desc)
+{
+  return desc >> DESC_DESLOCAMENTO_QUADRO;
+}
+
+// capacidade mínima do vetor de descritores, quando alocado
+#define CAPACIDADE_MINIMA 8
 
 struct tabpag_t {
   // número de descritores na tabela (pode ser 0)
   int tam_tab;
+  // número de descritores que cabem no vetor alocado (>= tam_tab)
+  // o vetor cresce dobrando a capacidade, e só diminui (pela metade) quando
+  //   fica com menos de 1/4 ocupado, para que a definição e invalidação
+  //   de páginas uma a uma não cause uma realocação a cada vez
+  int capacidade;
   // vetor com os descritores
-  // o último descritor do vetor sempre contém uma página válida
-  // pode ser NULL (se tam_tab == 0)
+  // o último descritor da tabela (tabela[tam_tab-1]) sempre contém uma
+  //   página válida
+  // pode ser NULL (se capacidade == 0)
   descritor_t *tabela;
+  // versão da tabela, diferente da de qualquer outra tabela já criada
+  unsigned versao;
+  // identificador do espaço de endereçamento
+  int asid;
+  // quem é avisado das alterações de páginas (ver tabpag_define_aviso)
+  tabpag_aviso_t aviso;
+  void *aviso_arg;
 };
 
-tabpag_t *tabpag_cria(void)
+// gerador de versões, para que duas tabelas nunca tenham a mesma versão
+static unsigned tabpag__ultima_versao = 0;
+
+// muda a versão da tabela
+static void tabpag__nova_versao(tabpag_t *self)
+{
+  self->versao = ++tabpag__ultima_versao;
+}
+
+void tabpag_define_aviso(tabpag_t *self, tabpag_aviso_t aviso, void *arg)
+{
+  self->aviso = aviso;
+  self->aviso_arg = arg;
+}
+
+// avisa que a página mudou; 'so_bits' se só os bits de acesso/alteração
+static void tabpag__avisa(tabpag_t *self, int pagina, bool so_bits)
+{
+  if (self->aviso != NULL) {
+    self->aviso(self->aviso_arg, self->asid, pagina, so_bits);
+  }
+}
+
+tabpag_t *tabpag_cria(int asid)
 {
+  assert(asid >= 0);
   tabpag_t *self = malloc(sizeof(*self));
   assert(self != NULL);
+  self->asid = asid;
   self->tam_tab = 0;
+  self->capacidade = 0;
   self->tabela = NULL;
+  self->aviso = NULL;
+  self->aviso_arg = NULL;
+  tabpag__nova_versao(self);
   return self;
 }
 
@@ -45,32 +104,50 @@ void tabpag_destroi(tabpag_t *self)
   }
 }
 
+// altera a capacidade do vetor de descritores (não menor que tam_tab)
+static void tabpag__realoca(tabpag_t *self, int capacidade)
+{
+  if (capacidade == 0) {
+    free(self->tabela);
+    self->tabela = NULL;
+  } else {
+    self->tabela = realloc(self->tabela, capacidade * sizeof(descritor_t));
+    assert(self->tabela != NULL);
+  }
+  self->capacidade = capacidade;
+}
+
+void tabpag_reserva(tabpag_t *self, int n_paginas)
+{
+  if (n_paginas > self->capacidade) {
+    tabpag__realoca(self, n_paginas);
+  }
+}
+
 // retorna true se a página for válida (pode ser traduzida em um quadro)
 static bool tabpag__pagina_valida(tabpag_t *self, int pagina)
 {
   if (pagina < 0 || pagina >= self->tam_tab) return false;
-  return self->tabela[pagina].valida;
+  return self->tabela[pagina] & DESC_VALIDA;
 }
 
 void tabpag_invalida_pagina(tabpag_t *self, int pagina)
 {
   // página já é inválida -- não faz nada
   if (!tabpag__pagina_valida(self, pagina)) return;
+  tabpag__avisa(self, pagina, false);
   // página não é a última da tabela -- marca como inválida
   if (pagina < self->tam_tab - 1) {
-    self->tabela[pagina].valida = false;
+    self->tabela[pagina] = 0;
     return;
   }
   // última página na tabela -- reduz a tabela até que a última seja válida
   do {
     self->tam_tab--;
-  } while (self->tam_tab > 0 && !self->tabela[self->tam_tab - 1].valida);
-  if (self->tam_tab == 0) {
-    free(self->tabela);
-    self->tabela = NULL;
-  } else {
-    self->tabela = realloc(self->tabela, self->tam_tab * sizeof(descritor_t));
-    assert(self->tabela != NULL);
+  } while (self->tam_tab > 0 && !(self->tabela[self->tam_tab - 1] & DESC_VALIDA));
+  // só libera memória se sobrar muito espaço
+  if (self->tam_tab < self->capacidade / 4 && self->capacidade > CAPACIDADE_MINIMA) {
+    tabpag__realoca(self, self->capacidade / 2);
   }
 }
 
@@ -79,15 +156,15 @@ static void tabpag__insere_pagina(tabpag_t *self, int pagina)
 {
   if (pagina < self->tam_tab) return;
   int novo_tam = pagina + 1;
-  if (self->tam_tab == 0) {
-    self->tabela = malloc(novo_tam * sizeof(descritor_t));
-  } else {
-    self->tabela = realloc(self->tabela, novo_tam * sizeof(descritor_t));
+  if (novo_tam > self->capacidade) {
+    int capacidade = self->capacidade * 2;
+    if (capacidade < CAPACIDADE_MINIMA) capacidade = CAPACIDADE_MINIMA;
+    if (capacidade < novo_tam) capacidade = novo_tam;
+    tabpag__realoca(self, capacidade);
   }
-  assert(self->tabela != NULL);
   // marca as páginas inseridas como não válidas
   while (self->tam_tab < novo_tam) {
-    self->tabela[self->tam_tab].valida = false;
+    self->tabela[self->tam_tab] = 0;
     self->tam_tab++;
   }
 }
@@ -95,61 +172,74 @@ static void tabpag__insere_pagina(tabpag_t *self, int pagina)
 void tabpag_define_quadro(tabpag_t *self, int pagina, int quadro)
 {
   assert(pagina >= 0);
+  assert(quadro >= 0 && quadro <= DESC_MAX_QUADRO);
   tabpag__insere_pagina(self, pagina);
-  self->tabela[pagina].quadro = quadro;
-  self->tabela[pagina].valida = true;
-  self->tabela[pagina].acessada = false;
-  self->tabela[pagina].alterada = false;
+  tabpag__avisa(self, pagina, false);
+  self->tabela[pagina] = ((descritor_t)quadro << DESC_DESLOCAMENTO_QUADRO)
+                       | DESC_PROTECAO | DESC_VALIDA;
 }
 
 void tabpag_marca_bit_acesso(tabpag_t *self, int pagina, bool alteracao)
 {
   if (!tabpag__pagina_valida(self, pagina)) return;
-  self->tabela[pagina].acessada = true;
-  if (alteracao) {
-    self->tabela[pagina].alterada = true;
-  }
+  // sem desvio: 'alteracao' (0 ou 1) vira o bit de alteração
+  self->tabela[pagina] |= DESC_ACESSADA | ((descritor_t)alteracao << DESC_BIT_ALTERADA);
 }
 
 void tabpag_zera_bit_acesso(tabpag_t *self, int pagina)
 {
   if (!tabpag__pagina_valida(self, pagina)) return;
-  self->tabela[pagina].acessada = false;
+  tabpag__avisa(self, pagina, true);
+  self->tabela[pagina] &= ~DESC_ACESSADA;
+}
+
+void tabpag_define_protecao(tabpag_t *self, int pagina, int protecao)
+{
+  if (!tabpag__pagina_valida(self, pagina)) return;
+  tabpag__avisa(self, pagina, false);
+  self->tabela[pagina] = (self->tabela[pagina] & ~DESC_PROTECAO)
+         | (((descritor_t)protecao << DESC_DESLOCAMENTO_PROTECAO) & DESC_PROTECAO);
+}
+
+int tabpag_protecao(tabpag_t *self, int pagina)
+{
+  if (!tabpag__pagina_valida(self, pagina)) return 0;
+  return (self->tabela[pagina] & DESC_PROTECAO) >> DESC_DESLOCAMENTO_PROTECAO;
 }
 
 bool tabpag_bit_acesso(tabpag_t *self, int pagina)
 {
   if (!tabpag__pagina_valida(self, pagina)) return false;
-  return self->tabela[pagina].acessada;
+  return self->tabela[pagina] & DESC_ACESSADA;
 }
 
 bool tabpag_bit_alteracao(tabpag_t *self, int pagina)
 {
   if (!tabpag__pagina_valida(self, pagina)) return false;
-  return self->tabela[pagina].alterada;
+  return self->tabela[pagina] & DESC_ALTERADA;
+}
+
+unsigned tabpag_versao(tabpag_t *self)
+{
+  return self->versao;
+}
+
+int tabpag_asid(tabpag_t *self)
+{
+  return self->asid;
 }
 
 err_t tabpag_traduz(tabpag_t *self, int pagina, int *pquadro)
 {
   if (!tabpag__pagina_valida(self, pagina)) return ERR_PAG_AUSENTE;
-  *pquadro = self->tabela[pagina].quadro;
+  *pquadro = desc_quadro(self->tabela[pagina]);
   return ERR_OK;
 }
 
 void tabpag_zera_bit_alterada(tabpag_t *self, int pagina){
     if (!tabpag__pagina_valida(self, pagina)) return;
-    self->tabela[pagina].alterada = false;
-}
-
-int tabpag_encontra_pagina_pelo_quadro(tabpag_t *tab, int quadro){
-  for(int p = 0; p < tab->tam_tab; p++) {
-      int q;
-      if (tabpag_traduz(tab, p, &q) == ERR_OK) {
-          if (q == quadro)
-              return p;
-      }
-  }
-  return -1;
+    tabpag__avisa(self, pagina, true);
+    self->tabela[pagina] &= ~DESC_ALTERADA;
 }
 
 int tabpag_numero_pagina(tabpag_t *tab){
@@ -10,7 +10,8 @@
 // realiza a tradução de números de páginas do espaço de endereçamento
 //   de um processo em números de quadros da memória principal onde essas
 //   páginas estão mapeadas
-// mantém para cada página mapeada um bit de acesso e um bit de alteração
+// mantém para cada página mapeada um bit de acesso e um bit de alteração,
+//   e a proteção da página (os tipos de acesso permitidos)
 
 #include "err.h"
 #include <stdbool.h>
@@ -18,11 +19,26 @@
 // tipo opaco que representa a tabela de páginas
 typedef struct tabpag_t tabpag_t;
 
+// proteção de uma página: os acessos permitidos além da leitura, que é
+//   sempre permitida
+#define TABPAG_ESCRITA    (1 << 0)  // a página pode ser alterada
+#define TABPAG_EXECUCAO   (1 << 1)  // a página pode conter instruções a executar
+#define TABPAG_PROT_TOTAL (TABPAG_ESCRITA | TABPAG_EXECUCAO)
+
 // cria uma tabela de páginas
+// 'asid' é o identificador do espaço de endereçamento descrito pela tabela
+//   (um número pequeno e não negativo), usado pela MMU para manter na TLB
+//   traduções de vários espaços de endereçamento ao mesmo tempo; tabelas
+//   em uso ao mesmo tempo devem ter identificadores diferentes
 // retorna um ponteiro para um descritor, que deverá ser usado em todas
 //   as operações nessa tabela
 // mata o programa em caso de erro (malloc)
-tabpag_t *tabpag_cria(void);
+tabpag_t *tabpag_cria(int asid);
+
+// reserva espaço na tabela para 'n_paginas' páginas (0 a n_paginas-1), para
+//   que a definição dessas páginas não precise alocar memória
+// não altera as páginas da tabela
+void tabpag_reserva(tabpag_t *self, int n_paginas);
 
 // destrói uma tabela de páginas
 // libera a memória ocupara pela tabela
@@ -32,9 +48,19 @@ void tabpag_destroi(tabpag_t *self);
 // define que a tradução da página 'pagina' deve resultar no quadro 'quadro'
 // essa página é marcada como válida, e os bits de acesso e alteração para essa
 //   página são zerados
+// a página tem proteção TABPAG_PROT_TOTAL (permite todos os acessos)
 // páginas sem quadro definido são consideradas inválidas
 void tabpag_define_quadro(tabpag_t *self, int pagina, int quadro);
 
+// altera a proteção da página 'pagina' para 'protecao' (combinação dos bits
+//   TABPAG_ESCRITA e TABPAG_EXECUCAO)
+// não faz nada se a página for inválida
+void tabpag_define_protecao(tabpag_t *self, int pagina, int protecao);
+
+// retorna a proteção da página
+// retorna 0 se a página for inválida
+int tabpag_protecao(tabpag_t *self, int pagina);
+
 // marca a página 'pagina' como inválida.
 // as informações sobre essa página são perdidas.
 void tabpag_invalida_pagina(tabpag_t *self, int pagina);
@@ -61,9 +87,32 @@ bool tabpag_bit_alteracao(tabpag_t *self, int pagina);
 // retorna ERR_PAG_AUSENTE (e não altera '*pquadro') se a página for inválida
 err_t tabpag_traduz(tabpag_t *self, int pagina, int *pquadro);
 
+// retorna a versão da tabela
+// nunca duas tabelas têm a mesma versão, mesmo que tenham o mesmo asid (uma
+//   destruída e outra criada depois)
+// usado pela MMU para não usar traduções na TLB de uma tabela que não existe
+//   mais
+unsigned tabpag_versao(tabpag_t *self);
+
+// função chamada quando a página 'pagina' da tabela com identificador 'asid'
+//   é alterada de forma que uma tradução, proteção ou bit obtido antes deixe
+//   de valer
+// 'so_bits' é true quando só os bits de acesso e alteração foram zerados
+//   (a tradução e a proteção continuam valendo), false quando a página foi
+//   definida, invalidada ou teve a proteção alterada
+typedef void (*tabpag_aviso_t)(void *arg, int asid, int pagina, bool so_bits);
+
+// define a função chamada nas alterações de páginas da tabela, com o
+//   argumento 'arg' (NULL para nenhuma); substitui a definida antes
+// usado pela MMU que recebe a tabela, para descartar da TLB só as traduções
+//   das páginas alteradas
+void tabpag_define_aviso(tabpag_t *self, tabpag_aviso_t aviso, void *arg);
+
+// retorna o identificador do espaço de endereçamento da tabela
+int tabpag_asid(tabpag_t *self);
+
 #define QUADRO_INVALIDO -1
 void tabpag_zera_bit_alterada(tabpag_t *self, int pagina);
-int tabpag_encontra_pagina_pelo_quadro(tabpag_t *tab, int quadro);
 int tabpag_numero_pagina(tabpag_t *tab);
 
 #endif // TABPAG_H
@@ -33,6 +33,8 @@ struct terminal_t {
   enum { normal, rolando, limpando } estado_saida;
   // posicao do caractere que está sendo movido durante uma rolagem
   int pos_rolagem;
+  // arquivo onde copiar os caracteres impressos (pode ser NULL)
+  FILE *copia_da_saida;
 };
 
 
@@ -48,6 +50,7 @@ terminal_t *terminal_cria(int tam_linha)
   assert(self->saida != NULL && self->entrada != NULL);
 
   self->estado_saida = normal;
+  self->copia_da_saida = NULL;
 
   return self;
 }
@@ -92,6 +95,8 @@ static err_t terminal_imprime(terminal_t *self, char ch)
 {
   if (!terminal_pode_imprimir(self)) return ERR_OCUP;
 
+  if (self->copia_da_saida != NULL) fputc(ch, self->copia_da_saida);
+
   if (ch == '\n') {
     // se for impresso \n, inicia a limpeza da linha
     self->estado_saida = limpando;
@@ -148,6 +153,11 @@ void terminal_tictac(terminal_t *self)
   terminal_atualiza_limpeza(self);
 }
 
+void terminal_define_copia_da_saida(terminal_t *self, FILE *arquivo)
+{
+  self->copia_da_saida = arquivo;
+}
+
 char *terminal_txt_entrada(terminal_t *self)
 {
   return self->entrada;
@@ -34,6 +34,7 @@
 //   linha de saída com terminal_limpa_saida.
 
 #include <stdbool.h>
+#include <stdio.h>
 #include "err.h"
 
 typedef struct terminal_t terminal_t;
@@ -65,6 +66,10 @@ void terminal_limpa_saida(terminal_t *self);
 // esta função deve ser chamada periodicamente
 void terminal_tictac(terminal_t *self);
 
+// define um arquivo para onde é copiado cada caractere impresso na saída
+//   (para uso pela console quando não tem tela); NULL para não copiar
+void terminal_define_copia_da_saida(terminal_t *self, FILE *arquivo);
+
 // Funções para implementar o protocolo de acesso a um dispositivo pelo
 //   controlador de E/S
 // Devem seguir o protocolo f_leitura_t e f_escrita_t declarados em es.h